@@ -0,0 +1,141 @@
+#include "asset_loader.h"
+#include "thread_pool.h"
+
+#include <chrono>
+#include <iostream>
+
+void AssetLoader::requestModel(const std::string &path)
+{
+	std::unique_ptr<PendingModel> pending(new PendingModel());
+	pending->path = path;
+	pending->decoding = ThreadPool::shared().submit([path]()
+	{
+		std::shared_ptr<ModelData> data = std::make_shared<ModelData>();
+		if (!ModelAsset::decode(path, *data))
+		{
+			data.reset();
+		}
+		return data;
+	});
+	models.push_back(std::move(pending));
+}
+
+void AssetLoader::requestTexture(const std::string &path, const TextureSampling &sampling)
+{
+	std::unique_ptr<PendingTexture> pending(new PendingTexture());
+	pending->path = path;
+	pending->sampling = sampling;
+	pending->decoding = ThreadPool::shared().submit([path]() { return ReadTextureImage(path); });
+	textures.push_back(std::move(pending));
+}
+
+template <typename T>
+static bool IsReady(const std::future<T> &future)
+{
+	return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+bool AssetLoader::advance(PendingModel &pending)
+{
+	// Decoded: hand the data to the upload context. The job only sees the pending entry,
+	// which stays alive until the upload has been published.
+	if (!pending.upload)
+	{
+		if (!IsReady(pending.decoding))
+		{
+			return false;
+		}
+		pending.data = pending.decoding.get();
+		if (!pending.data)
+		{
+			std::cerr << "Failed to load model " << pending.path << std::endl;
+			return true;
+		}
+
+		pending.asset = std::make_shared<ModelAsset>();
+		ModelAsset *asset = pending.asset.get();
+		const ModelData *data = pending.data.get();
+		pending.upload = uploader.submit([asset, data]() { asset->upload(*data); });
+	}
+
+	// Uploaded: build the VAO on this context and publish
+	if (!pending.upload->ready())
+	{
+		return false;
+	}
+	ModelAsset::publish(pending.asset);
+	loadedModels.push_back(pending.asset);
+	return true;
+}
+
+bool AssetLoader::advance(PendingTexture &pending)
+{
+	if (!pending.upload)
+	{
+		if (!IsReady(pending.decoding))
+		{
+			return false;
+		}
+		pending.image = pending.decoding.get();
+		if (!pending.image.valid())
+		{
+			std::cout << "Failed to load texture " << pending.path << std::endl;
+		}
+
+		PendingTexture *texture = &pending;
+		pending.upload = uploader.submit([texture]()
+		{
+			texture->texture = UploadTexture(texture->image, texture->sampling);
+		});
+	}
+
+	if (!pending.upload->ready())
+	{
+		return false;
+	}
+	loadedTextures.push_back(TextureManager::adopt(pending.path, pending.texture, pending.sampling));
+	return true;
+}
+
+bool AssetLoader::update()
+{
+	for (size_t i = 0; i < models.size();)
+	{
+		if (advance(*models[i]))
+		{
+			models.erase(models.begin() + i);
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	for (size_t i = 0; i < textures.size();)
+	{
+		if (advance(*textures[i]))
+		{
+			textures.erase(textures.begin() + i);
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	return models.empty() && textures.empty();
+}
+
+void AssetLoader::finish()
+{
+	while (!update())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+void AssetLoader::release()
+{
+	loadedModels.clear();
+	loadedTextures.clear();
+}
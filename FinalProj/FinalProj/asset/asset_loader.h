@@ -0,0 +1,69 @@
+#ifndef _ASSET_LOADER_H_
+#define _ASSET_LOADER_H_
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include <model/model_asset.h>
+#include <render/texture_manager.h>
+#include <render/upload_context.h>
+
+// Loads a set of models and textures together. File reads, glTF parsing, image decoding
+// and vertex extraction run on the shared ThreadPool as soon as they are requested, the
+// GL uploads run on the UploadContext. An asset is only published to the render thread
+// once the fence of its upload has signalled.
+//
+// The loader keeps every published asset alive until release(), so ModelAsset::acquire
+// and TextureManager::load calls for the same paths in between are cache hits.
+class AssetLoader
+{
+public:
+	// Uploads still in flight when the loader goes away must have been drained by
+	// UploadContext::cleanup() first
+	explicit AssetLoader(UploadContext &uploader) : uploader(uploader) {}
+
+	void requestModel(const std::string &path);
+	void requestTexture(const std::string &path, const TextureSampling &sampling = TextureSampling());
+
+	// Moves every request along without blocking, call once per frame to stream assets in.
+	// Returns true when nothing is pending any more.
+	bool update();
+
+	// Blocks until every request has been published
+	void finish();
+
+	// Drops the loader's references; assets nobody acquired are freed
+	void release();
+
+private:
+	struct PendingModel
+	{
+		std::string path;
+		std::future<std::shared_ptr<ModelData>> decoding;
+		std::shared_ptr<ModelData> data;
+		std::shared_ptr<ModelAsset> asset;
+		UploadHandle upload;
+	};
+
+	struct PendingTexture
+	{
+		std::string path;
+		TextureSampling sampling;
+		std::future<Image> decoding;
+		Image image;
+		TextureHandle texture;
+		UploadHandle upload;
+	};
+
+	bool advance(PendingModel &pending);
+	bool advance(PendingTexture &pending);
+
+	UploadContext &uploader;
+	std::vector<std::unique_ptr<PendingModel>> models;
+	std::vector<std::unique_ptr<PendingTexture>> textures;
+	std::vector<std::shared_ptr<ModelAsset>> loadedModels;
+	std::vector<TextureHandle> loadedTextures;
+};
+
+#endif
@@ -0,0 +1,186 @@
+#include "derived_data_cache.h"
+#include "virtual_file_system.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+static const char *DerivedDataDirectory = "derived_data";
+
+static uint64_t RotateLeft(uint64_t value, int bits)
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+
+static uint64_t Finalize(uint64_t hash)
+{
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdull;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ull;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+// MurmurHash3 style mixing of whole 64-bit words, fast enough to hash source files on every start
+uint64_t HashBytes(const void *data, size_t size, uint64_t seed)
+{
+	const uint64_t k1 = 0x87c37b91114253d5ull, k2 = 0x4cf5ad432745937full;
+	const unsigned char *bytes = static_cast<const unsigned char *>(data);
+	uint64_t hash = seed;
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		uint64_t word;
+		memcpy(&word, bytes + i, sizeof(word));
+		hash ^= RotateLeft(word * k1, 31) * k2;
+		hash = RotateLeft(hash, 27) * 5 + 0x52dce729;
+	}
+	uint64_t tail = 0;
+	for (size_t shift = 0; i < size; i++, shift += 8)
+	{
+		tail |= static_cast<uint64_t>(bytes[i]) << shift;
+	}
+	hash ^= RotateLeft(tail * k1, 31) * k2;
+	return Finalize(hash ^ size);
+}
+
+DerivedDataKey::DerivedDataKey(const char *kind, uint32_t version)
+	: kindName(kind), value(HashBytes(kind, strlen(kind), version))
+{
+}
+
+DerivedDataKey &DerivedDataKey::add(const void *data, size_t size)
+{
+	value = HashBytes(data, size, value);
+	return *this;
+}
+
+DerivedDataKey &DerivedDataKey::add(const std::string &text)
+{
+	return add(text.data(), text.size());
+}
+
+struct FileHash
+{
+	uint64_t size;
+	int64_t time;
+	uint64_t hash;
+};
+
+// Returns false when the file cannot be read
+static bool HashFile(const std::string &path, uint64_t &hash)
+{
+	static std::mutex mutex;
+	static std::unordered_map<std::string, FileHash> hashes;
+
+	uint64_t size;
+	int64_t time;
+	if (!VirtualFileSystem::stat(path, size, time))
+	{
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = hashes.find(path);
+		if (it != hashes.end() && it->second.size == size && it->second.time == time)
+		{
+			hash = it->second.hash;
+			return true;
+		}
+	}
+
+	VirtualFile file = VirtualFileSystem::open(path);
+	if (!file.valid())
+	{
+		return false;
+	}
+	hash = HashBytes(file.data(), file.size());
+
+	std::lock_guard<std::mutex> lock(mutex);
+	hashes[path] = { size, time, hash };
+	return true;
+}
+
+DerivedDataKey &DerivedDataKey::addFile(const std::string &path)
+{
+	uint64_t hash;
+	if (HashFile(path, hash))
+	{
+		add(hash);
+	}
+	else
+	{
+		isValid = false;
+	}
+	return *this;
+}
+
+DerivedDataKey &DerivedDataKey::addOptionalFile(const std::string &path)
+{
+	uint64_t hash;
+	return add(HashFile(path, hash) ? hash : Finalize(~0ull));
+}
+
+std::string DerivedDataCache::path(const DerivedDataKey &key)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key.hash()));
+	return (std::filesystem::path(DerivedDataDirectory) / key.kind() / name).string();
+}
+
+std::shared_ptr<MappedFile> DerivedDataCache::find(const DerivedDataKey &key)
+{
+	if (!key.valid())
+	{
+		return nullptr;
+	}
+
+	std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+	if (!file->open(path(key)))
+	{
+		return nullptr;
+	}
+	return file;
+}
+
+bool DerivedDataCache::store(const DerivedDataKey &key, const void *data, size_t size)
+{
+	if (!key.valid())
+	{
+		return false;
+	}
+
+	std::error_code error;
+	std::filesystem::path target(path(key));
+	std::filesystem::create_directories(target.parent_path(), error);
+
+	// Per thread, so two workers storing the same entry do not write into one file
+	char suffix[32];
+	snprintf(suffix, sizeof(suffix), ".%zx.tmp", std::hash<std::thread::id>()(std::this_thread::get_id()));
+	std::filesystem::path temporary = target.string() + suffix;
+	{
+		std::ofstream out(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+		{
+			return false;
+		}
+		out.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+		if (!out)
+		{
+			out.close();
+			std::filesystem::remove(temporary, error);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(temporary, target, error);
+	return !error;
+}
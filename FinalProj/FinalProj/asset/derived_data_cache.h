@@ -0,0 +1,60 @@
+#ifndef _DERIVED_DATA_CACHE_H_
+#define _DERIVED_DATA_CACHE_H_
+
+#include "mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// On-disk cache for the results of deterministic load-time work: cooked meshes, texture
+// mip chains, program binaries. Entries are keyed by a hash of everything the result was
+// computed from, the contents of the source files included, so a changed input or
+// parameter simply misses and nothing is ever invalidated by hand. Entries are kept in
+// derived_data/<kind>/ relative to the working directory.
+
+uint64_t HashBytes(const void *data, size_t size, uint64_t seed = 0);
+
+class DerivedDataKey
+{
+public:
+	// kind names the pass producing the data and version must be bumped whenever its
+	// output changes for the same input
+	DerivedDataKey(const char *kind, uint32_t version);
+
+	DerivedDataKey &add(const void *data, size_t size);
+	DerivedDataKey &add(const std::string &text);
+	DerivedDataKey &add(uint64_t value) { return add(&value, sizeof(value)); }
+
+	// Adds the contents of a file read through the VirtualFileSystem, hashed once per
+	// process for each size and modification time. A missing file makes the key invalid. Safe to call from worker threads.
+	DerivedDataKey &addFile(const std::string &path);
+
+	// As addFile, but a missing file is hashed as such instead of invalidating the key
+	DerivedDataKey &addOptionalFile(const std::string &path);
+
+	bool valid() const { return isValid; }
+	const std::string &kind() const { return kindName; }
+	uint64_t hash() const { return value; }
+
+private:
+	std::string kindName;
+	uint64_t value;
+	bool isValid = true;
+};
+
+namespace DerivedDataCache
+{
+	// Where the entry for key is kept
+	std::string path(const DerivedDataKey &key);
+
+	// Maps the entry for key. Returns nullptr on a miss or for an invalid key.
+	std::shared_ptr<MappedFile> find(const DerivedDataKey &key);
+
+	// Stores the entry for key. The file is written under a temporary name and renamed into
+	// place, so a reader never maps half of it. Returns false when it could not be written.
+	bool store(const DerivedDataKey &key, const void *data, size_t size);
+}
+
+#endif
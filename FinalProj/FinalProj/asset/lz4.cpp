@@ -0,0 +1,173 @@
+#include "lz4.h"
+
+#include <cstring>
+#include <vector>
+
+static const size_t MinMatch = 4;
+static const size_t LastLiterals = 5;		// The format ends every block with at least this many literals
+static const size_t MatchStartLimit = 12;	// and starts no match closer than this to the end
+static const size_t MaxOffset = 65535;
+static const int HashBits = 16;
+
+size_t LZ4CompressBound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+static uint32_t Read32(const uint8_t *p)
+{
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static uint8_t *WriteLength(uint8_t *out, size_t length)
+{
+	for (; length >= 255; length -= 255)
+	{
+		*out++ = 255;
+	}
+	*out++ = static_cast<uint8_t>(length);
+	return out;
+}
+
+// One sequence: token, literal run, then the match unless it is the last sequence
+static uint8_t *WriteSequence(uint8_t *out, const uint8_t *literals, size_t literalLength, size_t offset, size_t matchLength)
+{
+	uint8_t *token = out++;
+	*token = static_cast<uint8_t>((literalLength < 15 ? literalLength : 15) << 4);
+	if (literalLength >= 15)
+	{
+		out = WriteLength(out, literalLength - 15);
+	}
+	memcpy(out, literals, literalLength);
+	out += literalLength;
+
+	if (matchLength > 0)
+	{
+		*out++ = static_cast<uint8_t>(offset);
+		*out++ = static_cast<uint8_t>(offset >> 8);
+		size_t length = matchLength - MinMatch;
+		*token |= static_cast<uint8_t>(length < 15 ? length : 15);
+		if (length >= 15)
+		{
+			out = WriteLength(out, length - 15);
+		}
+	}
+	return out;
+}
+
+size_t LZ4Compress(const uint8_t *src, size_t size, uint8_t *dst)
+{
+	// Last position each hashed 4 byte sequence was seen at, plus one so 0 means never
+	std::vector<uint32_t> table(size_t(1) << HashBits, 0);
+	uint8_t *out = dst;
+	size_t anchor = 0;
+
+	if (size > MatchStartLimit)
+	{
+		size_t i = 0;
+		while (i < size - MatchStartLimit)
+		{
+			uint32_t sequence = Read32(src + i);
+			uint32_t hash = (sequence * 2654435761u) >> (32 - HashBits);
+			size_t candidate = table[hash];
+			table[hash] = static_cast<uint32_t>(i + 1);
+
+			if (candidate == 0 || i - (candidate - 1) > MaxOffset || Read32(src + candidate - 1) != sequence)
+			{
+				i++;
+				continue;
+			}
+
+			size_t match = candidate - 1;
+			size_t length = MinMatch;
+			while (i + length < size - LastLiterals && src[match + length] == src[i + length])
+			{
+				length++;
+			}
+			out = WriteSequence(out, src + anchor, i - anchor, i - match, length);
+			i += length;
+			anchor = i;
+		}
+	}
+
+	out = WriteSequence(out, src + anchor, size - anchor, 0, 0);
+	return static_cast<size_t>(out - dst);
+}
+
+static bool ReadLength(const uint8_t *src, size_t srcSize, size_t &in, size_t &length)
+{
+	uint8_t byte;
+	do
+	{
+		if (in >= srcSize)
+		{
+			return false;
+		}
+		byte = src[in++];
+		length += byte;
+	} while (byte == 255);
+	return true;
+}
+
+bool LZ4Decompress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstSize)
+{
+	size_t in = 0, out = 0;
+	while (in < srcSize)
+	{
+		uint8_t token = src[in++];
+
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && !ReadLength(src, srcSize, in, literalLength))
+		{
+			return false;
+		}
+		if (literalLength > srcSize - in || literalLength > dstSize - out)
+		{
+			return false;
+		}
+		memcpy(dst + out, src + in, literalLength);
+		in += literalLength;
+		out += literalLength;
+
+		// The last sequence has no match
+		if (in == srcSize)
+		{
+			break;
+		}
+
+		if (srcSize - in < 2)
+		{
+			return false;
+		}
+		size_t offset = src[in] | (static_cast<size_t>(src[in + 1]) << 8);
+		in += 2;
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !ReadLength(src, srcSize, in, matchLength))
+		{
+			return false;
+		}
+		matchLength += MinMatch;
+		if (offset == 0 || offset > out || matchLength > dstSize - out)
+		{
+			return false;
+		}
+
+		// Matches may overlap their own output, which repeats the last offset bytes
+		const uint8_t *match = dst + out - offset;
+		if (offset >= matchLength)
+		{
+			memcpy(dst + out, match, matchLength);
+		}
+		else
+		{
+			for (size_t i = 0; i < matchLength; i++)
+			{
+				dst[out + i] = match[i];
+			}
+		}
+		out += matchLength;
+	}
+	return out == dstSize;
+}
@@ -0,0 +1,22 @@
+#ifndef _LZ4_H_
+#define _LZ4_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Codec for the LZ4 block format: byte-aligned literal runs and matches within the last
+// 64 KB, no entropy coding. Decoding runs at memory speed, which is what pack file
+// entries need; compression is a single greedy pass with a hash table.
+
+// Worst-case size of compressing size bytes
+size_t LZ4CompressBound(size_t size);
+
+// Compresses size bytes of src into dst, which holds LZ4CompressBound(size) bytes.
+// Returns the compressed size.
+size_t LZ4Compress(const uint8_t *src, size_t size, uint8_t *dst);
+
+// Decompresses a block into exactly dstSize bytes. Returns false when the block is
+// malformed or does not decode to dstSize bytes.
+bool LZ4Decompress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstSize);
+
+#endif
@@ -0,0 +1,118 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string &path)
+{
+	close();
+
+	HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	file = handle;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		close();
+		return false;
+	}
+
+	mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		close();
+		return false;
+	}
+
+	bytes = static_cast<const unsigned char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (bytes == nullptr)
+	{
+		close();
+		return false;
+	}
+	length = static_cast<size_t>(fileSize.QuadPart);
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (bytes)
+	{
+		UnmapViewOfFile(bytes);
+	}
+	if (mapping)
+	{
+		CloseHandle(mapping);
+	}
+	if (file)
+	{
+		CloseHandle(file);
+	}
+	bytes = nullptr;
+	length = 0;
+	mapping = nullptr;
+	file = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::string &path)
+{
+	close();
+
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	// The mapping stays valid after the descriptor is closed
+	void *view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (view == MAP_FAILED)
+	{
+		return false;
+	}
+
+	bytes = static_cast<const unsigned char *>(view);
+	length = static_cast<size_t>(info.st_size);
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (bytes)
+	{
+		munmap(const_cast<unsigned char *>(bytes), length);
+	}
+	bytes = nullptr;
+	length = 0;
+}
+
+#endif
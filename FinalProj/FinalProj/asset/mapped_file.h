@@ -0,0 +1,33 @@
+#ifndef _MAPPED_FILE_H_
+#define _MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+
+// Read-only view of a whole file mapped into memory. Pages are loaded by the OS on
+// first touch, so opening costs nothing beyond the system calls.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	// Returns false when the file is missing, empty or cannot be mapped
+	bool open(const std::string &path);
+	void close();
+
+	const unsigned char *data() const { return bytes; }
+	size_t size() const { return length; }
+
+private:
+	const unsigned char *bytes = nullptr;
+	size_t length = 0;
+#ifdef _WIN32
+	void *file = nullptr;
+	void *mapping = nullptr;
+#endif
+};
+
+#endif
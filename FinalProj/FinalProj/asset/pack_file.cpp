@@ -0,0 +1,142 @@
+#include "pack_file.h"
+#include "lz4.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+bool PackFile::open(const std::string &path)
+{
+	if (!file.open(path) || file.size() < sizeof(PackFileHeader))
+	{
+		return false;
+	}
+
+	PackFileHeader header;
+	memcpy(&header, file.data(), sizeof(header));
+	if (header.magic != PACK_FILE_MAGIC || header.version != PACK_FILE_VERSION
+		|| header.indexOffset % alignof(PackFileEntry) != 0
+		|| header.indexOffset + uint64_t(header.entryCount) * sizeof(PackFileEntry) > file.size()
+		|| header.namesOffset > file.size())
+	{
+		file.close();
+		return false;
+	}
+
+	// Every entry and name must lie inside the file
+	entries = reinterpret_cast<const PackFileEntry *>(file.data() + header.indexOffset);
+	names = reinterpret_cast<const char *>(file.data() + header.namesOffset);
+	for (uint32_t i = 0; i < header.entryCount; i++)
+	{
+		const PackFileEntry &entry = entries[i];
+		if (entry.offset + entry.storedSize > file.size()
+			|| header.namesOffset + entry.nameOffset + entry.nameLength > file.size()
+			|| (entry.compression == PACK_STORED && entry.storedSize != entry.size)
+			|| entry.compression > PACK_LZ4)
+		{
+			file.close();
+			return false;
+		}
+	}
+	count = header.entryCount;
+	return true;
+}
+
+const PackFileEntry *PackFile::find(const std::string &key) const
+{
+	const PackFileEntry *end = entries + count;
+	const PackFileEntry *it = std::lower_bound(entries, end, key, [this](const PackFileEntry &entry, const std::string &value)
+	{
+		return name(entry) < value;
+	});
+	return it != end && name(*it) == key ? it : nullptr;
+}
+
+static uint64_t AlignEntry(uint64_t offset)
+{
+	return (offset + PACK_FILE_ALIGNMENT - 1) / PACK_FILE_ALIGNMENT * PACK_FILE_ALIGNMENT;
+}
+
+bool WritePackFile(const std::string &path, std::vector<PackSource> sources)
+{
+	std::sort(sources.begin(), sources.end(), [](const PackSource &a, const PackSource &b) { return a.name < b.name; });
+	sources.erase(std::unique(sources.begin(), sources.end(), [](const PackSource &a, const PackSource &b) { return a.name == b.name; }), sources.end());
+
+	std::string temporary = path + ".tmp";
+	std::ofstream out(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+	{
+		return false;
+	}
+
+	// Header first as a placeholder, it is rewritten once the offsets are known
+	PackFileHeader header = {};
+	header.magic = PACK_FILE_MAGIC;
+	header.version = PACK_FILE_VERSION;
+	header.entryCount = static_cast<uint32_t>(sources.size());
+	out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	uint64_t offset = sizeof(header);
+
+	static const char padding[PACK_FILE_ALIGNMENT] = {};
+	std::vector<PackFileEntry> entries;
+	std::string names;
+	std::vector<uint8_t> compressed;
+	for (const PackSource &source : sources)
+	{
+		PackFileEntry entry = {};
+		entry.nameOffset = static_cast<uint32_t>(names.size());
+		entry.nameLength = static_cast<uint32_t>(source.name.size());
+		names += source.name;
+
+		// Empty files cannot be mapped, but are still packed
+		MappedFile file;
+		std::error_code error;
+		bool empty = std::filesystem::file_size(source.path, error) == 0 && !error;
+		if (!empty && !file.open(source.path))
+		{
+			std::cerr << "Cannot read " << source.path << std::endl;
+			out.close();
+			std::filesystem::remove(temporary, error);
+			return false;
+		}
+		entry.size = file.size();
+
+		const char *bytes = reinterpret_cast<const char *>(file.data());
+		entry.storedSize = entry.size;
+		compressed.resize(LZ4CompressBound(file.size()));
+		size_t compressedSize = file.size() > 0 ? LZ4Compress(file.data(), file.size(), compressed.data()) : 0;
+		if (file.size() > 0 && compressedSize <= file.size() - file.size() / 8)
+		{
+			entry.compression = PACK_LZ4;
+			entry.storedSize = compressedSize;
+			bytes = reinterpret_cast<const char *>(compressed.data());
+		}
+
+		uint64_t aligned = AlignEntry(offset);
+		out.write(padding, static_cast<std::streamsize>(aligned - offset));
+		entry.offset = aligned;
+		out.write(bytes, static_cast<std::streamsize>(entry.storedSize));
+		offset = aligned + entry.storedSize;
+		entries.push_back(entry);
+	}
+
+	header.indexOffset = AlignEntry(offset);
+	out.write(padding, static_cast<std::streamsize>(header.indexOffset - offset));
+	out.write(reinterpret_cast<const char *>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(PackFileEntry)));
+	header.namesOffset = header.indexOffset + entries.size() * sizeof(PackFileEntry);
+	out.write(names.data(), static_cast<std::streamsize>(names.size()));
+
+	out.seekp(0);
+	out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	out.close();
+	if (!out)
+	{
+		return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+	return !error;
+}
@@ -0,0 +1,82 @@
+#ifndef _PACK_FILE_H_
+#define _PACK_FILE_H_
+
+#include "mapped_file.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Pack files bundle the game's data files into one archive that is memory-mapped once
+// and read in place. Layout, native endianness:
+//
+//   PackFileHeader
+//   entry data             each on a PACK_FILE_ALIGNMENT boundary, stored or LZ4 compressed
+//   PackFileEntry[count]   at indexOffset, sorted by name
+//   char[]                 at namesOffset, entry names without terminators
+//
+// Names are relative paths with '/' separators.
+const uint32_t PACK_FILE_MAGIC = 0x4B505046;	// "FPPK"
+const uint32_t PACK_FILE_VERSION = 1;
+const uint64_t PACK_FILE_ALIGNMENT = 64;
+
+enum PackCompression : uint32_t
+{
+	PACK_STORED = 0,
+	PACK_LZ4 = 1
+};
+
+struct PackFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t reserved;
+	uint64_t indexOffset;
+	uint64_t namesOffset;
+};
+
+struct PackFileEntry
+{
+	uint32_t nameOffset;	// Relative to namesOffset
+	uint32_t nameLength;
+	uint64_t offset;
+	uint64_t storedSize;
+	uint64_t size;			// Once decompressed
+	uint32_t compression;
+	uint32_t reserved;
+};
+
+class PackFile
+{
+public:
+	// Returns false when the file is missing or malformed
+	bool open(const std::string &path);
+
+	// Binary search of the index. Returns nullptr when there is no entry called key.
+	const PackFileEntry *find(const std::string &key) const;
+
+	const unsigned char *data(const PackFileEntry &entry) const { return file.data() + entry.offset; }
+	uint32_t entryCount() const { return count; }
+	const PackFileEntry &entry(uint32_t index) const { return entries[index]; }
+	std::string name(const PackFileEntry &entry) const { return std::string(names + entry.nameOffset, entry.nameLength); }
+
+private:
+	MappedFile file;
+	const PackFileEntry *entries = nullptr;
+	uint32_t count = 0;
+	const char *names = nullptr;
+};
+
+struct PackSource
+{
+	std::string name;		// Entry name in the pack
+	std::string path;		// File to read it from
+};
+
+// Writes a pack file holding every source. Entries are LZ4 compressed when that saves at
+// least an eighth of their size, so already compressed images stay stored and mappable.
+// Returns false when a source cannot be read or the pack cannot be written.
+bool WritePackFile(const std::string &path, std::vector<PackSource> sources);
+
+#endif
@@ -0,0 +1,55 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned threadCount)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	for (unsigned i = 0; i < threadCount; ++i)
+	{
+		workers.emplace_back(&ThreadPool::run, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	// Workers drain the queue before they exit, so no future is left without a result
+	for (std::thread &worker : workers)
+	{
+		worker.join();
+	}
+}
+
+ThreadPool &ThreadPool::shared()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::run()
+{
+	for (;;)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if (jobs.empty())
+			{
+				return;
+			}
+			job = std::move(jobs.front());
+			jobs.pop();
+		}
+		job();
+	}
+}
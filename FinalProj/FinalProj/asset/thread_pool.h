@@ -0,0 +1,56 @@
+#ifndef _THREAD_POOL_H_
+#define _THREAD_POOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running submitted jobs in FIFO order.
+// Jobs must not touch GL, no context is current on the workers. GL work off the render
+// thread goes through UploadContext, which owns its own shared context and thread.
+class ThreadPool
+{
+public:
+	// threadCount 0 uses one worker per hardware thread
+	explicit ThreadPool(unsigned threadCount = 0);
+	~ThreadPool();
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	size_t size() const { return workers.size(); }
+
+	// Queues job and returns a future for its result. Exceptions thrown by the
+	// job are rethrown from future::get().
+	template <typename F>
+	auto submit(F &&job) -> std::future<decltype(job())>
+	{
+		typedef decltype(job()) Result;
+		auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+		std::future<Result> result = task->get_future();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push([task]() { (*task)(); });
+		}
+		wake.notify_one();
+		return result;
+	}
+
+	// Pool shared by the asset loaders and the occlusion culler, created on first use
+	static ThreadPool &shared();
+
+private:
+	void run();
+
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping = false;
+};
+
+#endif
@@ -0,0 +1,177 @@
+#include "virtual_file_system.h"
+#include "lz4.h"
+#include "mapped_file.h"
+#include "pack_file.h"
+
+#include <filesystem>
+#include <mutex>
+#include <vector>
+
+struct MountedPack
+{
+	std::string prefix;
+	PackFile pack;
+	int64_t time;
+};
+
+static std::mutex MountMutex;
+static std::vector<std::shared_ptr<MountedPack>> Mounts;
+
+// Folds "." and "dir/.." away and turns '\' into '/', so differently spelled paths to
+// one file compare equal. Leading ".." segments are kept.
+static std::string NormalizePath(const std::string &path)
+{
+	std::vector<std::string> segments;
+	size_t start = 0;
+	while (start <= path.size())
+	{
+		size_t end = path.find_first_of("/\\", start);
+		if (end == std::string::npos)
+		{
+			end = path.size();
+		}
+		std::string segment = path.substr(start, end - start);
+		if (segment == "..")
+		{
+			if (!segments.empty() && segments.back() != ".." && !segments.back().empty())
+			{
+				segments.pop_back();
+			}
+			else
+			{
+				segments.push_back(segment);
+			}
+		}
+		else if (segment != "." && (!segment.empty() || start == 0))
+		{
+			segments.push_back(segment);
+		}
+		start = end + 1;
+	}
+
+	std::string normalized;
+	for (size_t i = 0; i < segments.size(); i++)
+	{
+		normalized += (i > 0 ? "/" : "") + segments[i];
+	}
+	return normalized;
+}
+
+// Finds the pack entry behind path, searching the latest mount first
+static std::shared_ptr<MountedPack> FindEntry(const std::string &path, const PackFileEntry *&entry)
+{
+	std::string normalized = NormalizePath(path);
+	std::lock_guard<std::mutex> lock(MountMutex);
+	for (auto it = Mounts.rbegin(); it != Mounts.rend(); ++it)
+	{
+		const std::string &prefix = (*it)->prefix;
+		if (normalized.size() > prefix.size() + 1 && normalized.compare(0, prefix.size(), prefix) == 0
+			&& normalized[prefix.size()] == '/')
+		{
+			entry = (*it)->pack.find(normalized.substr(prefix.size() + 1));
+			if (entry)
+			{
+				return *it;
+			}
+		}
+	}
+	return nullptr;
+}
+
+bool VirtualFileSystem::mount(const std::string &packPath, const std::string &prefix)
+{
+	std::shared_ptr<MountedPack> mounted = std::make_shared<MountedPack>();
+	if (!mounted->pack.open(packPath))
+	{
+		return false;
+	}
+	mounted->prefix = NormalizePath(prefix);
+	std::error_code error;
+	mounted->time = std::filesystem::last_write_time(packPath, error).time_since_epoch().count();
+
+	std::lock_guard<std::mutex> lock(MountMutex);
+	Mounts.push_back(mounted);
+	return true;
+}
+
+void VirtualFileSystem::unmountAll()
+{
+	std::lock_guard<std::mutex> lock(MountMutex);
+	Mounts.clear();
+}
+
+bool VirtualFileSystem::stat(const std::string &path, uint64_t &size, int64_t &time)
+{
+	const PackFileEntry *entry;
+	if (std::shared_ptr<MountedPack> mounted = FindEntry(path, entry))
+	{
+		size = entry->size;
+		time = mounted->time;
+		return true;
+	}
+
+	std::error_code error;
+	size = std::filesystem::file_size(path, error);
+	if (error)
+	{
+		return false;
+	}
+	time = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+	return !error;
+}
+
+bool VirtualFileSystem::exists(const std::string &path)
+{
+	uint64_t size;
+	int64_t time;
+	return stat(path, size, time);
+}
+
+// Fills in the private members of VirtualFile
+class VirtualFileAccess
+{
+public:
+	static VirtualFile make(const unsigned char *bytes, size_t length, std::shared_ptr<const void> owner)
+	{
+		VirtualFile file;
+		file.bytes = bytes;
+		file.length = length;
+		file.found = true;
+		file.owner = std::move(owner);
+		return file;
+	}
+};
+
+VirtualFile VirtualFileSystem::open(const std::string &path)
+{
+	const PackFileEntry *entry;
+	if (std::shared_ptr<MountedPack> mounted = FindEntry(path, entry))
+	{
+		const unsigned char *stored = mounted->pack.data(*entry);
+		if (entry->compression == PACK_STORED)
+		{
+			return VirtualFileAccess::make(stored, entry->size, mounted);
+		}
+
+		std::shared_ptr<std::vector<unsigned char>> bytes = std::make_shared<std::vector<unsigned char>>(entry->size);
+		if (!LZ4Decompress(stored, entry->storedSize, bytes->data(), bytes->size()))
+		{
+			return VirtualFile();
+		}
+		return VirtualFileAccess::make(bytes->data(), bytes->size(), bytes);
+	}
+
+	std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+	if (file->open(path))
+	{
+		return VirtualFileAccess::make(file->data(), file->size(), file);
+	}
+
+	// Empty files cannot be mapped
+	std::error_code error;
+	if (std::filesystem::is_regular_file(path, error) && std::filesystem::file_size(path, error) == 0 && !error)
+	{
+		return VirtualFileAccess::make(nullptr, 0, nullptr);
+	}
+	return VirtualFile();
+}
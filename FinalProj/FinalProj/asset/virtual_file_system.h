@@ -0,0 +1,49 @@
+#ifndef _VIRTUAL_FILE_SYSTEM_H_
+#define _VIRTUAL_FILE_SYSTEM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Contents of a file opened through the VirtualFileSystem. Stored pack entries and
+// loose files are mapped, compressed entries are decompressed into memory; either way
+// the bytes stay valid for as long as a copy of the VirtualFile lives.
+class VirtualFile
+{
+public:
+	bool valid() const { return found; }
+	const unsigned char *data() const { return bytes; }
+	size_t size() const { return length; }
+	std::string text() const { return std::string(reinterpret_cast<const char *>(bytes), length); }
+
+private:
+	friend class VirtualFileAccess;
+
+	const unsigned char *bytes = nullptr;
+	size_t length = 0;
+	bool found = false;
+	std::shared_ptr<const void> owner;
+};
+
+// Resolves the game's file paths against mounted pack files before the disk, so a
+// deployed build reads everything from one mapped archive while a development tree
+// keeps working from loose files. Safe to use from any thread.
+namespace VirtualFileSystem
+{
+	// Mounts the pack file at packPath under prefix: its entry "road/pavement.jpg" is found
+	// as prefix + "/road/pavement.jpg". Packs mounted later are searched first. Returns
+	// false when the pack is missing or malformed.
+	bool mount(const std::string &packPath, const std::string &prefix);
+	void unmountAll();
+
+	// Size and modification time of path. Pack entries report the time of their pack.
+	bool stat(const std::string &path, uint64_t &size, int64_t &time);
+
+	bool exists(const std::string &path);
+
+	// Returns an invalid VirtualFile when path is neither in a pack nor on disk
+	VirtualFile open(const std::string &path);
+}
+
+#endif
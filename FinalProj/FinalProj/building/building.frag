@@ -1,15 +1,18 @@
 #version 330 core
 
-in vec3 fragColor;
-in vec2 UV;
+in vec3 UV;
 in vec3 fragNormal;
 in vec3 fragPosition;
 in vec4 fragPosLightSpace;
 
-uniform sampler2D textureSampler;
-uniform vec3 lightPosition;
-uniform vec3 lightIntensity;
-uniform vec3 viewPosition;
+uniform sampler2DArray textureSampler;
+layout(std140) uniform FrameConstants {
+    mat4 viewProjection;
+    mat4 lightSpaceMatrix;
+    vec4 lightPosition;
+    vec4 lightIntensity;
+    vec4 viewPosition;
+};
 uniform sampler2D depthMap;
 
 out vec3 color;
@@ -41,24 +44,24 @@ void main() {
 
     // Normalize input vectors
     vec3 normal = normalize(fragNormal);
-    vec3 lightDir = normalize(lightPosition - fragPosition);
-    vec3 viewDir = normalize(viewPosition - fragPosition);
+    vec3 lightDir = normalize(lightPosition.xyz - fragPosition);
+    vec3 viewDir = normalize(viewPosition.xyz - fragPosition);
 
     // Ambient lighting
     float ambientStrength = 0.3;
-    vec3 ambient = ambientStrength * lightIntensity;
+    vec3 ambient = ambientStrength * lightIntensity.rgb;
 
     // Diffuse lighting
     float diff = max(dot(normal, lightDir), 0.0);
-    vec3 diffuse = diff * lightIntensity;
+    vec3 diffuse = diff * lightIntensity.rgb;
 
     // Specular lighting
     float specularStrength = 0.5;
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
-    vec3 specular = specularStrength * spec * lightIntensity;
+    vec3 specular = specularStrength * spec * lightIntensity.rgb;
 
     // Combine results
     vec3 result = (ambient + diffuse + specular) * texture(textureSampler, UV).rgb;
     color = result;  // * shadow
-}
\ No newline at end of file
+}
@@ -0,0 +1,37 @@
+#version 330 core
+
+layout(location = 0) in vec3 vertexPosition;
+layout(location = 1) in vec2 vertexUV;
+layout(location = 2) in vec3 vertexNormal;
+
+// Per-instance attributes
+layout(location = 3) in vec3 instancePosition;
+layout(location = 4) in vec3 instanceScale;
+layout(location = 5) in float instanceLayer;
+
+layout(std140) uniform FrameConstants {
+    mat4 viewProjection;
+    mat4 lightSpaceMatrix;
+    vec4 lightPosition;
+    vec4 lightIntensity;
+    vec4 viewPosition;
+};
+
+out vec3 UV;
+out vec3 fragNormal;
+out vec3 fragPosition;
+out vec4 fragPosLightSpace;
+
+void main() {
+    // Model transform is translate * scale, so apply it directly
+    vec4 worldPosition = vec4(instancePosition + instanceScale * vertexPosition, 1.0);
+    gl_Position = viewProjection * worldPosition;
+
+    UV = vec3(vertexUV, instanceLayer);
+    fragPosition = worldPosition.xyz;
+
+    // Inverse-transpose of a scale matrix is the reciprocal scale
+    fragNormal = vertexNormal / instanceScale;
+
+    fragPosLightSpace = lightSpaceMatrix * worldPosition;
+}
@@ -0,0 +1,306 @@
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <asset/thread_pool.h>
+#include <render/pixel_unpack_ring.h>
+#include <render/shader.h>
+#include <render/texture_manager.h>
+#include <algorithm>
+#include <iostream>
+#include "building.h"
+#include "building_batch.h"
+
+// Bilinear resample of an RGBA8 image, used to bring every facade to the array layer size
+static void ResampleRGBA(const uint8_t *src, int srcW, int srcH, uint8_t *dst, int dstW, int dstH) {
+	for (int y = 0; y < dstH; ++y) {
+		float fy = std::max(0.0f, (y + 0.5f) * srcH / dstH - 0.5f);
+		int y0 = std::min(static_cast<int>(fy), srcH - 1);
+		int y1 = std::min(y0 + 1, srcH - 1);
+		float ty = fy - y0;
+		for (int x = 0; x < dstW; ++x) {
+			float fx = std::max(0.0f, (x + 0.5f) * srcW / dstW - 0.5f);
+			int x0 = std::min(static_cast<int>(fx), srcW - 1);
+			int x1 = std::min(x0 + 1, srcW - 1);
+			float tx = fx - x0;
+			for (int c = 0; c < 4; ++c) {
+				float top = src[(y0 * srcW + x0) * 4 + c] * (1 - tx) + src[(y0 * srcW + x1) * 4 + c] * tx;
+				float bottom = src[(y1 * srcW + x0) * 4 + c] * (1 - tx) + src[(y1 * srcW + x1) * 4 + c] * tx;
+				dst[(y * dstW + x) * 4 + c] = static_cast<uint8_t>(top * (1 - ty) + bottom * ty + 0.5f);
+			}
+		}
+	}
+}
+
+static GLuint LoadTextureArray(const std::vector<const char*> &texture_file_paths) {
+	// Decode every facade in parallel
+	std::vector<std::future<Image>> decoding;
+	for (const char *path : texture_file_paths) {
+		decoding.push_back(ThreadPool::shared().submit([path]() { return DecodeImageRGBA(path); }));
+	}
+
+	// All layers of a texture array share one size, use the largest facade
+	std::vector<Image> images;
+	int layerW = 1, layerH = 1;
+	for (size_t i = 0; i < decoding.size(); ++i) {
+		Image img = decoding[i].get();
+		if (!img.valid()) {
+			std::cout << "Failed to load texture " << texture_file_paths[i] << std::endl;
+		} else {
+			layerW = std::max(layerW, img.width);
+			layerH = std::max(layerH, img.height);
+		}
+		images.push_back(std::move(img));
+	}
+
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+
+	// To tile textures on a box, we set wrapping to repeat
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, layerW, layerH, static_cast<GLsizei>(images.size()), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+	// Each layer is written straight into the pixel unpack ring, client memory is only the fallback
+	PixelUnpackRing &ring = PixelUnpackRing::current();
+	size_t layerSize = static_cast<size_t>(layerW) * layerH * 4;
+	std::vector<uint8_t> fallback;
+	for (size_t i = 0; i < images.size(); ++i) {
+		PixelUnpackRing::Region staging = ring.allocate(static_cast<GLsizeiptr>(layerSize));
+		if (!staging.data) {
+			ring.retire(staging);
+			fallback.resize(layerSize);
+		}
+		uint8_t *layer = staging.data ? staging.data : fallback.data();
+
+		const Image &img = images[i];
+		if (img.valid()) {
+			if (img.width == layerW && img.height == layerH) {
+				std::copy(img.pixels.get(), img.pixels.get() + layerSize, layer);
+			} else {
+				ResampleRGBA(img.pixels.get(), img.width, img.height, layer, layerW, layerH);
+			}
+		} else {
+			std::fill(layer, layer + layerSize, 255);
+		}
+
+		if (staging.data) {
+			ring.unmap(staging);
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<GLint>(i), layerW, layerH, 1, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<const void*>(staging.offset));
+			ring.retire(staging);
+		} else {
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<GLint>(i), layerW, layerH, 1, GL_RGBA, GL_UNSIGNED_BYTE, layer);
+		}
+		images[i].pixels.reset();
+	}
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+	return texture;
+}
+
+void BuildingBatch::initialize(const std::vector<const char*> &texture_file_paths) {
+	// One shared box, placed and scaled per instance
+	glGenVertexArrays(1, &vertexArrayID);
+	glBindVertexArray(vertexArrayID);
+
+	// Vertices
+	glGenBuffers(1, &vertexBufferID);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(BuildingCubeVertices), BuildingCubeVertices, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+
+	// UVs
+	glGenBuffers(1, &uvBufferID);
+	glBindBuffer(GL_ARRAY_BUFFER, uvBufferID);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(BuildingCubeUVs), BuildingCubeUVs, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, 0);
+
+	// Normals
+	glGenBuffers(1, &normalBufferID);
+	glBindBuffer(GL_ARRAY_BUFFER, normalBufferID);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(BuildingCubeNormals), BuildingCubeNormals, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, 0);
+
+	// Per-building position, scale and texture layer, advanced once per instance
+	glGenBuffers(1, &instanceBufferID);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBufferID);
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(BuildingInstance), (void*)offsetof(BuildingInstance, position));
+	glVertexAttribDivisor(3, 1);
+	glEnableVertexAttribArray(4);
+	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(BuildingInstance), (void*)offsetof(BuildingInstance, scale));
+	glVertexAttribDivisor(4, 1);
+	glEnableVertexAttribArray(5);
+	glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, sizeof(BuildingInstance), (void*)offsetof(BuildingInstance, layer));
+	glVertexAttribDivisor(5, 1);
+
+	// Indices
+	glGenBuffers(1, &indexBufferID);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(BuildingCubeIndices), BuildingCubeIndices, GL_STATIC_DRAW);
+	indexCount = sizeof(BuildingCubeIndices) / sizeof(GLuint);
+
+	glBindVertexArray(0);
+
+	// Create and compile our GLSL programs from the shaders
+	programID = LoadShadersFromFile("../FinalProj/building/building.vert", "../FinalProj/building/building.frag");
+	if (programID == 0) {
+		std::cerr << "Failed to load building shaders." << std::endl;
+	}
+	depthProgramID = LoadShadersFromFile("../FinalProj/building/building_depth.vert", "../FinalProj/s.frag");
+	if (depthProgramID == 0) {
+		std::cerr << "Failed to load building depth shaders." << std::endl;
+	}
+
+	// Get handles for the samplers, everything else is in the frame uniform buffer
+	ShaderProgram program(programID);
+	textureSamplerID = program.uniform("textureSampler");
+	depthMapID = program.uniform("depthMap");
+
+	// Load every facade into one texture array, the proxies get an atlas of its small mips
+	textureArrayID = LoadTextureArray(texture_file_paths);
+	hlod.initialize(textureArrayID);
+}
+
+void BuildingBatch::add(glm::vec3 position, glm::vec3 scale, int textureLayer) {
+	instances.push_back({position, scale, static_cast<GLfloat>(textureLayer)});
+	dirty = true;
+}
+
+void BuildingBatch::attachCulling(FrustumCuller &culler) {
+	this->culler = &culler;
+	dirty = true;
+	uploadInstances();
+}
+
+void BuildingBatch::uploadInstances() {
+	if (!dirty) return;
+
+	// New buildings mean new clusters, all drawn in full until the next update
+	hlod.build(instances);
+	if (culler) {
+		// Boxes are never freed: buildings added after attaching move to new ranges and the
+		// old ones are emptied, so they never show up in a pass again
+		if (instanceBoxes.count != instances.size() || clusterBoxes.count != hlod.clusters.size()) {
+			culler->clear(instanceBoxes);
+			culler->clear(clusterBoxes);
+			instanceBoxes = culler->add(static_cast<uint32_t>(instances.size()));
+			clusterBoxes = culler->add(static_cast<uint32_t>(hlod.clusters.size()));
+		}
+		for (size_t i = 0; i < instances.size(); ++i) {
+			// The cube spans [-1, 1] on x and z and [0, 2] up, scaled and moved as building.vert does
+			const BuildingInstance &instance = instances[i];
+			culler->set(instanceBoxes.first + i, instance.position + instance.scale * glm::vec3(-1.0f, 0.0f, -1.0f),
+						instance.position + instance.scale * glm::vec3(1.0f, 2.0f, 1.0f));
+		}
+		for (size_t c = 0; c < hlod.clusters.size(); ++c) {
+			culler->set(clusterBoxes.first + c, hlod.clusters[c].boundsMin, hlod.clusters[c].boundsMax);
+		}
+	}
+	uploadDrawnInstances();
+	dirty = false;
+}
+
+void BuildingBatch::uploadDrawnInstances() {
+	drawn.clear();
+	hlod.clearProxies();
+	for (int pass = 0; pass < CULL_PASS_COUNT; ++pass) {
+		passFirst[pass] = drawn.size();
+		if (culler) {
+			culler->result(static_cast<CullPass>(pass)).mark(instanceBoxes, visibleInstances);
+			culler->result(static_cast<CullPass>(pass)).mark(clusterBoxes, visibleClusters);
+		} else {
+			visibleInstances.assign(instances.size(), 1);
+			visibleClusters.assign(hlod.clusters.size(), 1);
+		}
+
+		// A visible cluster draws its proxy, or those of its buildings that are visible too
+		for (size_t c = 0; c < hlod.clusters.size(); ++c) {
+			const BuildingCluster &cluster = hlod.clusters[c];
+			if (!visibleClusters[c]) continue;
+			if (cluster.proxy) {
+				hlod.addProxy(static_cast<CullPass>(pass), cluster);
+				continue;
+			}
+			for (size_t i = cluster.firstInstance; i < cluster.firstInstance + cluster.instanceCount; ++i) {
+				if (visibleInstances[i]) drawn.push_back(instances[i]);
+			}
+		}
+	}
+	passFirst[CULL_PASS_COUNT] = drawn.size();
+
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBufferID);
+	if (drawn.size() > instanceCapacity) {
+		instanceCapacity = drawn.size();
+		glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(BuildingInstance), nullptr, GL_DYNAMIC_DRAW);
+	}
+	glBufferSubData(GL_ARRAY_BUFFER, 0, drawn.size() * sizeof(BuildingInstance), drawn.data());
+}
+
+void BuildingBatch::update(const LodView &view) {
+	uploadInstances();
+	hlod.update(view);
+	uploadDrawnInstances();
+}
+
+void BuildingBatch::drawInstances(CullPass pass) {
+	GLsizei count = static_cast<GLsizei>(passFirst[pass + 1] - passFirst[pass]);
+	if (count == 0) return;
+
+	// Instance attributes start at the pass's part of the buffer
+	glBindVertexArray(vertexArrayID);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBufferID);
+	size_t offset = passFirst[pass] * sizeof(BuildingInstance);
+	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(BuildingInstance), (void*)(offset + offsetof(BuildingInstance, position)));
+	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(BuildingInstance), (void*)(offset + offsetof(BuildingInstance, scale)));
+	glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, sizeof(BuildingInstance), (void*)(offset + offsetof(BuildingInstance, layer)));
+	glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (void*)0, count);
+	glBindVertexArray(0);
+}
+
+void BuildingBatch::render_first_pass() {
+	if (instances.empty()) return;
+	uploadInstances();
+
+	glUseProgram(depthProgramID);
+
+	// Draw every box of the near clusters, then the far ones' proxies
+	drawInstances(CULL_PASS_SHADOW);
+	hlod.render_first_pass();
+}
+
+void BuildingBatch::render_second_pass() {
+	if (instances.empty()) return;
+	uploadInstances();
+
+	glUseProgram(programID);
+
+	// Facades on unit 0, the shadow map stays bound on unit 1
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureArrayID);
+	glUniform1i(textureSamplerID, 0);
+	glUniform1i(depthMapID, 1);
+
+	// Draw every box of the near clusters, then the far ones' proxies
+	drawInstances(CULL_PASS_CAMERA);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	hlod.render_second_pass();
+}
+
+void BuildingBatch::cleanup() {
+	glDeleteBuffers(1, &vertexBufferID);
+	glDeleteBuffers(1, &uvBufferID);
+	glDeleteBuffers(1, &normalBufferID);
+	glDeleteBuffers(1, &instanceBufferID);
+	glDeleteBuffers(1, &indexBufferID);
+	glDeleteVertexArrays(1, &vertexArrayID);
+	glDeleteTextures(1, &textureArrayID);
+	ReleaseShaders(programID);
+	ReleaseShaders(depthProgramID);
+	hlod.cleanup();
+}
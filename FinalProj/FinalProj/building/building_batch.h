@@ -0,0 +1,56 @@
+#ifndef BUILDING_BATCH_H
+#define BUILDING_BATCH_H
+#include <vector>
+#include <glm/glm.hpp>
+#include "glad/gl.h"
+#include <render/frame_constants.h>
+#include <render/frustum_culler.h>
+#include "building_hlod.h"
+
+// Per-building data stored in the instance buffer
+struct BuildingInstance {
+	glm::vec3 position;
+	glm::vec3 scale;
+	GLfloat layer;		// Layer of the facade texture array
+};
+
+// All box buildings of the city, sharing one cube mesh and one GL_TEXTURE_2D_ARRAY of facades.
+// Each pass is a single glDrawElementsInstanced call for the buildings of near clusters, and
+// one more for the proxies of far ones, see BuildingHlod. With culling attached, every
+// building and every cluster has a box in the culler and each pass only draws those it sees;
+// the instance buffer holds the shadow pass's buildings, then the camera pass's.
+struct BuildingBatch {
+	GLuint vertexArrayID, vertexBufferID, uvBufferID, normalBufferID, indexBufferID, instanceBufferID;
+	GLuint textureArrayID, programID, depthProgramID;
+	GLint textureSamplerID, depthMapID;
+	GLsizei indexCount;
+
+	std::vector<BuildingInstance> instances;	// Sorted by cluster once uploaded
+	std::vector<BuildingInstance> drawn;		// Instances each pass draws, by pass
+	size_t passFirst[CULL_PASS_COUNT + 1] = {};	// Pass p draws drawn[passFirst[p], passFirst[p + 1])
+	size_t instanceCapacity = 0;
+	bool dirty = true;
+	BuildingHlod hlod;
+
+	FrustumCuller *culler = nullptr;
+	CullRange instanceBoxes, clusterBoxes;	// Replaced when buildings are added after attaching
+	std::vector<uint8_t> visibleInstances, visibleClusters;
+
+	// Each texture file becomes one layer of the texture array, in the given order
+	void initialize(const std::vector<const char*> &texture_file_paths);
+	void add(glm::vec3 position, glm::vec3 scale, int textureLayer);
+	// Gives every building and cluster a box in culler, whose results update() then reads
+	void attachCulling(FrustumCuller &culler);
+	void uploadInstances();
+	void uploadDrawnInstances();
+	// Picks buildings or proxy for every cluster and what each pass draws, once per frame
+	// after the passes are culled
+	void update(const LodView &view);
+	// Camera and light matrices come from the FrameConstants uniform buffer
+	void drawInstances(CullPass pass);
+	void render_first_pass();
+	void render_second_pass();
+	void cleanup();
+};
+
+#endif //BUILDING_BATCH_H
@@ -0,0 +1,19 @@
+#version 330 core
+
+layout(location = 0) in vec3 vertexPosition;
+
+// Per-instance attributes
+layout(location = 3) in vec3 instancePosition;
+layout(location = 4) in vec3 instanceScale;
+
+layout(std140) uniform FrameConstants {
+    mat4 viewProjection;
+    mat4 lightSpaceMatrix;
+    vec4 lightPosition;
+    vec4 lightIntensity;
+    vec4 viewPosition;
+};
+
+void main() {
+    gl_Position = lightSpaceMatrix * vec4(instancePosition + instanceScale * vertexPosition, 1.0);
+}
@@ -0,0 +1,370 @@
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <render/shader.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <map>
+#include "building.h"
+#include "building_batch.h"
+#include "building_hlod.h"
+
+// Side of the ground cells buildings are clustered by
+static const float HlodCellSize = 150.0f;
+
+// A cluster turns into its proxy once the nearest point of its bounding sphere is farther
+// than this fraction of the far plane. With the scene's far plane of 1200 that is 1020
+// units, past every cluster from the start position, which are 417 to 977 away.
+static const float HlodProxyDistance = 0.85f;
+
+// Largest facade atlas tile. From HlodProxyDistance on, each facade of a cluster covers
+// about ten pixels and is sampled from mips smaller than this anyway.
+static const int HlodTileSize = 32;
+
+// A proxy only turns back into buildings this far inside the switch distance, so a cluster
+// does not switch back and forth at it
+static const float HlodHysteresis = 0.9f;
+
+void BuildingHlod::initialize(GLuint textureArrayID) {
+	// The first level of the facade array no larger than a tile
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureArrayID);
+	GLint width, height, layers;
+	glGetTexLevelParameteriv(GL_TEXTURE_2D_ARRAY, 0, GL_TEXTURE_DEPTH, &layers);
+	int level = 0;
+	for (;; ++level) {
+		glGetTexLevelParameteriv(GL_TEXTURE_2D_ARRAY, level, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D_ARRAY, level, GL_TEXTURE_HEIGHT, &height);
+		if ((width <= HlodTileSize && height <= HlodTileSize) || (width == 1 && height == 1)) {
+			break;
+		}
+	}
+	std::vector<uint8_t> levelPixels(static_cast<size_t>(width) * height * layers * 4);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glGetTexImage(GL_TEXTURE_2D_ARRAY, level, GL_RGBA, GL_UNSIGNED_BYTE, levelPixels.data());
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	// Layers side by side in one row
+	GLsizei atlasWidth = width * layers;
+	std::vector<uint8_t> atlas(static_cast<size_t>(atlasWidth) * height * 4);
+	for (int layer = 0; layer < layers; ++layer) {
+		for (int y = 0; y < height; ++y) {
+			const uint8_t *src = &levelPixels[((static_cast<size_t>(layer) * height + y) * width) * 4];
+			std::copy(src, src + width * 4, &atlas[(static_cast<size_t>(y) * atlasWidth + layer * width) * 4]);
+		}
+	}
+	atlasLayers = static_cast<GLfloat>(layers);
+
+	glGenTextures(1, &atlasID);
+	glBindTexture(GL_TEXTURE_2D, atlasID);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, atlasWidth, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, atlas.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	// Mips stop at 4 texels a tile, smaller ones would blend neighbouring facades
+	int maxLevel = std::max(0, static_cast<int>(std::log2(static_cast<float>(std::min(width, height)))) - 2);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, maxLevel);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// Proxy vertices and indices, one buffer each for every cluster
+	glGenVertexArrays(1, &vertexArrayID);
+	glBindVertexArray(vertexArrayID);
+	glGenBuffers(1, &vertexBufferID);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(BuildingProxyVertex), (void*)offsetof(BuildingProxyVertex, position));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(BuildingProxyVertex), (void*)offsetof(BuildingProxyVertex, uv));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(BuildingProxyVertex), (void*)offsetof(BuildingProxyVertex, normal));
+	glGenBuffers(1, &indexBufferID);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+	glBindVertexArray(0);
+
+	programID = LoadShadersFromFile("../FinalProj/building/building_proxy.vert", "../FinalProj/building/building_proxy.frag");
+	if (programID == 0) {
+		std::cerr << "Failed to load building proxy shaders." << std::endl;
+	}
+	depthProgramID = LoadShadersFromFile("../FinalProj/building/building_proxy_depth.vert", "../FinalProj/s.frag");
+	if (depthProgramID == 0) {
+		std::cerr << "Failed to load building proxy depth shaders." << std::endl;
+	}
+	ShaderProgram program(programID);
+	atlasSamplerID = program.uniform("atlasSampler");
+	atlasLayersID = program.uniform("atlasLayers");
+}
+
+// Facade coordinates of a point on the side of instance facing along normal, as the box the
+// instances draw maps them. Tops and bottoms are untextured.
+static glm::vec2 FacadeUV(const BuildingInstance &instance, const glm::vec3 &normal, const glm::vec3 &position) {
+	if (normal.y != 0.0f) {
+		return glm::vec2(0.0f);
+	}
+	glm::vec3 local = (position - instance.position) / instance.scale;
+	float u = normal.z > 0.0f ? local.x + 1.0f
+			: normal.z < 0.0f ? 1.0f - local.x
+			: normal.x > 0.0f ? 1.0f - local.z
+			: local.z + 1.0f;
+	return glm::vec2(u * 0.5f, BuildingFacadeRepeat * (1.0f - local.y * 0.5f));
+}
+
+// Indexed proxy of one cluster, welding corners that share position, normal and facade
+struct ProxyMesh {
+	std::vector<BuildingProxyVertex> &vertices;
+	std::vector<GLuint> &indices;
+	std::map<std::array<float, 9>, GLuint> welded;
+
+	GLuint vertex(const glm::vec3 &position, const glm::vec3 &normal, const glm::vec3 &uv) {
+		std::array<float, 9> key = { position.x, position.y, position.z, normal.x, normal.y, normal.z, uv.x, uv.y, uv.z };
+		auto it = welded.find(key);
+		if (it != welded.end()) {
+			return it->second;
+		}
+		GLuint index = static_cast<GLuint>(vertices.size());
+		vertices.push_back({ position, normal, uv });
+		welded.emplace(key, index);
+		return index;
+	}
+
+	// Corners in order around the quad, which faces along normal
+	void quad(glm::vec3 corners[4], const glm::vec3 &normal, const BuildingInstance &instance) {
+		if (glm::dot(glm::cross(corners[1] - corners[0], corners[2] - corners[0]), normal) < 0.0f) {
+			std::swap(corners[1], corners[3]);
+		}
+		GLuint index[4];
+		for (int k = 0; k < 4; ++k) {
+			index[k] = vertex(corners[k], normal, glm::vec3(FacadeUV(instance, normal, corners[k]), instance.layer));
+		}
+		for (int k : { 0, 1, 2, 0, 2, 3 }) {
+			indices.push_back(index[k]);
+		}
+	}
+};
+
+// Outer shell of buildings standing on the ground. Their footprints are cut along every box
+// edge into a grid, each cell takes the height of the tallest box over it, and only the tops
+// and the walls between cells of different heights remain. The top of one building and runs
+// of wall along one side of it become single quads.
+static void AddShell(ProxyMesh &mesh, const std::vector<const BuildingInstance*> &boxes) {
+	if (boxes.empty()) return;
+
+	std::vector<float> xs, zs;
+	for (const BuildingInstance *box : boxes) {
+		xs.push_back(box->position.x - box->scale.x);
+		xs.push_back(box->position.x + box->scale.x);
+		zs.push_back(box->position.z - box->scale.z);
+		zs.push_back(box->position.z + box->scale.z);
+	}
+	std::sort(xs.begin(), xs.end());
+	xs.erase(std::unique(xs.begin(), xs.end()), xs.end());
+	std::sort(zs.begin(), zs.end());
+	zs.erase(std::unique(zs.begin(), zs.end()), zs.end());
+
+	// Tallest box over each cell, -1 for none, cell (i, j) at j * nx + i
+	size_t nx = xs.size() - 1, nz = zs.size() - 1;
+	auto top = [&](int box) { return box < 0 ? 0.0f : boxes[box]->position.y + 2.0f * boxes[box]->scale.y; };
+	std::vector<int> owner(nx * nz, -1);
+	for (size_t j = 0; j < nz; ++j) {
+		for (size_t i = 0; i < nx; ++i) {
+			float x = (xs[i] + xs[i+1]) * 0.5f, z = (zs[j] + zs[j+1]) * 0.5f;
+			for (size_t b = 0; b < boxes.size(); ++b) {
+				const BuildingInstance &box = *boxes[b];
+				if (std::abs(x - box.position.x) < box.scale.x && std::abs(z - box.position.z) < box.scale.z &&
+					top(static_cast<int>(b)) > top(owner[j * nx + i])) {
+					owner[j * nx + i] = static_cast<int>(b);
+				}
+			}
+		}
+	}
+
+	// Tops, as rectangles of cells under one box
+	std::vector<bool> done(owner.size(), false);
+	for (size_t j = 0; j < nz; ++j) {
+		for (size_t i = 0; i < nx; ++i) {
+			int box = owner[j * nx + i];
+			if (box < 0 || done[j * nx + i]) continue;
+			size_t i1 = i + 1, j1 = j + 1;
+			while (i1 < nx && owner[j * nx + i1] == box && !done[j * nx + i1]) ++i1;
+			for (; j1 < nz; ++j1) {
+				bool same = true;
+				for (size_t k = i; k < i1 && same; ++k) {
+					same = owner[j1 * nx + k] == box && !done[j1 * nx + k];
+				}
+				if (!same) break;
+			}
+			for (size_t jj = j; jj < j1; ++jj) {
+				std::fill(done.begin() + jj * nx + i, done.begin() + jj * nx + i1, true);
+			}
+			float y = top(box);
+			glm::vec3 corners[4] = { { xs[i], y, zs[j] }, { xs[i1], y, zs[j] }, { xs[i1], y, zs[j1] }, { xs[i], y, zs[j1] } };
+			mesh.quad(corners, glm::vec3(0.0f, 1.0f, 0.0f), *boxes[box]);
+		}
+	}
+
+	// Walls on the grid lines across x, then across z, where the cells on either side differ
+	// in height. Each belongs to the taller side and faces the lower one.
+	for (int axis = 0; axis < 2; ++axis) {
+		const std::vector<float> &lines = axis == 0 ? xs : zs, &steps = axis == 0 ? zs : xs;
+		for (size_t line = 0; line < lines.size(); ++line) {
+			auto side = [&](size_t step, bool after) {
+				if (after ? line + 1 == lines.size() : line == 0) return -1;
+				size_t across = after ? line : line - 1;
+				return axis == 0 ? owner[step * nx + across] : owner[across * nx + step];
+			};
+			for (size_t step = 0; step + 1 < steps.size(); ) {
+				int before = side(step, false), after = side(step, true);
+				if (top(before) == top(after)) {
+					++step;
+					continue;
+				}
+				bool facesAfter = top(before) > top(after);
+				int box = facesAfter ? before : after;
+				float low = std::min(top(before), top(after)), high = top(box);
+				size_t end = step + 1;
+				for (; end + 1 < steps.size(); ++end) {
+					int nextBefore = side(end, false), nextAfter = side(end, true);
+					if ((facesAfter ? nextBefore : nextAfter) != box || top(facesAfter ? nextAfter : nextBefore) != low ||
+						top(nextBefore) == top(nextAfter)) {
+						break;
+					}
+				}
+
+				glm::vec3 normal(0.0f);
+				normal[axis == 0 ? 0 : 2] = facesAfter ? 1.0f : -1.0f;
+				glm::vec3 corners[4];
+				for (int k = 0; k < 4; ++k) {
+					float along = k == 1 || k == 2 ? steps[end] : steps[step];
+					float y = k < 2 ? low : high;
+					corners[k] = axis == 0 ? glm::vec3(lines[line], y, along) : glm::vec3(along, y, lines[line]);
+				}
+				mesh.quad(corners, normal, *boxes[box]);
+				step = end;
+			}
+		}
+	}
+}
+
+// Every face of a box clear of the ground, bottom included
+static void AddBox(ProxyMesh &mesh, const BuildingInstance &instance) {
+	for (int face = 0; face < 6; ++face) {
+		glm::vec3 corners[4];
+		for (int k = 0; k < 4; ++k) {
+			const GLfloat *corner = &BuildingCubeVertices[3 * (4 * face + k)];
+			corners[k] = instance.position + instance.scale * glm::vec3(corner[0], corner[1], corner[2]);
+		}
+		const GLfloat *normal = &BuildingCubeNormals[3 * 4 * face];
+		mesh.quad(corners, glm::vec3(normal[0], normal[1], normal[2]), instance);
+	}
+}
+
+void BuildingHlod::build(std::vector<BuildingInstance> &instances) {
+	// Group the buildings by the cell under their centre, keeping their order within a cell
+	auto cellOf = [](const BuildingInstance &instance) {
+		return std::make_pair(static_cast<int>(std::floor(instance.position.x / HlodCellSize)),
+							  static_cast<int>(std::floor(instance.position.z / HlodCellSize)));
+	};
+	std::stable_sort(instances.begin(), instances.end(), [&](const BuildingInstance &a, const BuildingInstance &b) {
+		return cellOf(a) < cellOf(b);
+	});
+
+	clusters.clear();
+	std::vector<BuildingProxyVertex> vertices;
+	std::vector<GLuint> indices;
+	for (size_t i = 0; i < instances.size(); ) {
+		BuildingCluster cluster;
+		cluster.firstInstance = i;
+		cluster.firstProxyIndex = indices.size();
+		cluster.boundsMin = glm::vec3(INFINITY);
+		cluster.boundsMax = glm::vec3(-INFINITY);
+		cluster.proxy = false;
+
+		ProxyMesh mesh = { vertices, indices, {} };
+		std::vector<const BuildingInstance*> grounded;
+		for (; i < instances.size() && cellOf(instances[i]) == cellOf(instances[cluster.firstInstance]); ++i) {
+			const BuildingInstance &instance = instances[i];
+			cluster.boundsMin = glm::min(cluster.boundsMin, instance.position + instance.scale * glm::vec3(-1.0f, 0.0f, -1.0f));
+			cluster.boundsMax = glm::max(cluster.boundsMax, instance.position + instance.scale * glm::vec3(1.0f, 2.0f, 1.0f));
+			if (instance.position.y > 0.0f) {
+				AddBox(mesh, instance);
+			} else {
+				grounded.push_back(&instance);
+			}
+		}
+		AddShell(mesh, grounded);
+
+		cluster.instanceCount = i - cluster.firstInstance;
+		cluster.proxyIndexCount = static_cast<GLsizei>(indices.size() - cluster.firstProxyIndex);
+		clusters.push_back(cluster);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(BuildingProxyVertex), vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(vertexArrayID);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+	glBindVertexArray(0);
+	clearProxies();
+}
+
+void BuildingHlod::update(const LodView &view) {
+	for (BuildingCluster &cluster : clusters) {
+		// Distance to the bounding sphere, nothing is a proxy from inside it
+		glm::vec3 centre = (cluster.boundsMin + cluster.boundsMax) * 0.5f;
+		float radius = glm::length(cluster.boundsMax - cluster.boundsMin) * 0.5f;
+		float distance = glm::length(centre - view.position) - radius;
+
+		float proxyDistance = HlodProxyDistance * view.farDistance;
+		cluster.proxy = distance > proxyDistance * (cluster.proxy ? HlodHysteresis : 1.0f);
+	}
+}
+
+void BuildingHlod::clearProxies() {
+	for (int pass = 0; pass < CULL_PASS_COUNT; ++pass) {
+		proxyOffsets[pass].clear();
+		proxyCounts[pass].clear();
+	}
+}
+
+void BuildingHlod::addProxy(CullPass pass, const BuildingCluster &cluster) {
+	proxyOffsets[pass].push_back((const void*)(cluster.firstProxyIndex * sizeof(GLuint)));
+	proxyCounts[pass].push_back(cluster.proxyIndexCount);
+}
+
+void BuildingHlod::render_first_pass() {
+	const std::vector<const void*> &offsets = proxyOffsets[CULL_PASS_SHADOW];
+	if (offsets.empty()) return;
+
+	glUseProgram(depthProgramID);
+	glBindVertexArray(vertexArrayID);
+	glMultiDrawElements(GL_TRIANGLES, proxyCounts[CULL_PASS_SHADOW].data(), GL_UNSIGNED_INT, offsets.data(), static_cast<GLsizei>(offsets.size()));
+	glBindVertexArray(0);
+}
+
+void BuildingHlod::render_second_pass() {
+	const std::vector<const void*> &offsets = proxyOffsets[CULL_PASS_CAMERA];
+	if (offsets.empty()) return;
+
+	glUseProgram(programID);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, atlasID);
+	glUniform1i(atlasSamplerID, 0);
+	glUniform1f(atlasLayersID, atlasLayers);
+
+	glBindVertexArray(vertexArrayID);
+	glMultiDrawElements(GL_TRIANGLES, proxyCounts[CULL_PASS_CAMERA].data(), GL_UNSIGNED_INT, offsets.data(), static_cast<GLsizei>(offsets.size()));
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void BuildingHlod::cleanup() {
+	glDeleteBuffers(1, &vertexBufferID);
+	glDeleteBuffers(1, &indexBufferID);
+	glDeleteVertexArrays(1, &vertexArrayID);
+	glDeleteTextures(1, &atlasID);
+	ReleaseShaders(programID);
+	ReleaseShaders(depthProgramID);
+}
@@ -0,0 +1,57 @@
+#ifndef BUILDING_HLOD_H
+#define BUILDING_HLOD_H
+#include <vector>
+#include <glm/glm.hpp>
+#include "glad/gl.h"
+#include <render/frame_constants.h>
+#include <render/frustum_culler.h>
+
+struct BuildingInstance;
+
+// Buildings in one cell of the ground grid
+struct BuildingCluster {
+	glm::vec3 boundsMin, boundsMax;
+	size_t firstInstance, instanceCount;	// Range of the batch's instances
+	size_t firstProxyIndex;
+	GLsizei proxyIndexCount;
+	bool proxy;								// Drawn as its proxy since the last update
+};
+
+// Vertex of a proxy mesh, already in world space
+struct BuildingProxyVertex {
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec3 uv;		// Facade coordinates and texture layer, as the instanced boxes use them
+};
+
+// Hierarchical level of detail of a BuildingBatch. The buildings are clustered by a grid over
+// the ground, and each cluster is merged into one indexed proxy mesh: the outer shell of its
+// boxes, with no bottoms and no faces inside or against another building, coplanar pieces
+// merged and shared corners welded, textured from an atlas of small mips of the facades.
+// A cluster near the far plane is drawn as its proxy instead of its buildings, and every
+// proxy a pass sees goes in one glMultiDrawElements call.
+struct BuildingHlod {
+	GLuint vertexArrayID, vertexBufferID, indexBufferID, atlasID, programID, depthProgramID;
+	GLint atlasSamplerID, atlasLayersID;
+	GLfloat atlasLayers;
+
+	std::vector<BuildingCluster> clusters;
+	std::vector<const void*> proxyOffsets[CULL_PASS_COUNT];	// Proxies each pass draws, for glMultiDrawElements
+	std::vector<GLsizei> proxyCounts[CULL_PASS_COUNT];
+
+	// Builds the facade atlas from a level of the batch's texture array
+	void initialize(GLuint textureArrayID);
+	// Sorts instances into clusters and bakes the proxy of each. Every cluster starts out drawn in full.
+	void build(std::vector<BuildingInstance> &instances);
+	// Picks proxy or buildings for every cluster
+	void update(const LodView &view);
+	// Lists of proxies to draw, refilled by the batch once its clusters are culled
+	void clearProxies();
+	void addProxy(CullPass pass, const BuildingCluster &cluster);
+	// Proxy counterparts of the BuildingBatch passes
+	void render_first_pass();
+	void render_second_pass();
+	void cleanup();
+};
+
+#endif //BUILDING_HLOD_H
@@ -0,0 +1,46 @@
+#version 330 core
+
+in vec3 UV;
+in vec3 fragNormal;
+in vec3 fragPosition;
+
+// Facade layers side by side, atlasLayers tiles in one row
+uniform sampler2D atlasSampler;
+uniform float atlasLayers;
+layout(std140) uniform FrameConstants {
+    mat4 viewProjection;
+    mat4 lightSpaceMatrix;
+    vec4 lightPosition;
+    vec4 lightIntensity;
+    vec4 viewPosition;
+};
+
+out vec3 color;
+
+void main() {
+    // Repeat inside the tile of the layer as the array texture repeats, with the gradients
+    // of the unwrapped coordinates so the wrap does not drop to the smallest mip
+    vec2 tileScale = vec2(1.0 / atlasLayers, 1.0);
+    vec2 halfTexel = 0.5 / vec2(textureSize(atlasSampler, 0));
+    vec2 tile = clamp(fract(UV.xy), halfTexel * vec2(atlasLayers, 1.0), 1.0 - halfTexel * vec2(atlasLayers, 1.0));
+    vec2 atlasUV = (vec2(UV.z, 0.0) + tile) * tileScale;
+    vec3 facade = textureGrad(atlasSampler, atlasUV, dFdx(UV.xy) * tileScale, dFdy(UV.xy) * tileScale).rgb;
+
+    // Lighting as in building.frag
+    vec3 normal = normalize(fragNormal);
+    vec3 lightDir = normalize(lightPosition.xyz - fragPosition);
+    vec3 viewDir = normalize(viewPosition.xyz - fragPosition);
+
+    float ambientStrength = 0.3;
+    vec3 ambient = ambientStrength * lightIntensity.rgb;
+
+    float diff = max(dot(normal, lightDir), 0.0);
+    vec3 diffuse = diff * lightIntensity.rgb;
+
+    float specularStrength = 0.5;
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
+    vec3 specular = specularStrength * spec * lightIntensity.rgb;
+
+    color = (ambient + diffuse + specular) * facade;
+}
@@ -0,0 +1,25 @@
+#version 330 core
+
+// Proxy vertices are already in world space
+layout(location = 0) in vec3 vertexPosition;
+layout(location = 1) in vec3 vertexUV;
+layout(location = 2) in vec3 vertexNormal;
+
+layout(std140) uniform FrameConstants {
+    mat4 viewProjection;
+    mat4 lightSpaceMatrix;
+    vec4 lightPosition;
+    vec4 lightIntensity;
+    vec4 viewPosition;
+};
+
+out vec3 UV;
+out vec3 fragNormal;
+out vec3 fragPosition;
+
+void main() {
+    gl_Position = viewProjection * vec4(vertexPosition, 1.0);
+    UV = vertexUV;
+    fragNormal = vertexNormal;
+    fragPosition = vertexPosition;
+}
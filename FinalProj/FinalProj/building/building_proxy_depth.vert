@@ -0,0 +1,15 @@
+#version 330 core
+
+layout(location = 0) in vec3 vertexPosition;
+
+layout(std140) uniform FrameConstants {
+    mat4 viewProjection;
+    mat4 lightSpaceMatrix;
+    vec4 lightPosition;
+    vec4 lightIntensity;
+    vec4 viewPosition;
+};
+
+void main() {
+    gl_Position = lightSpaceMatrix * vec4(vertexPosition, 1.0);
+}
@@ -0,0 +1,166 @@
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb/stb_image.h>
+#include <stb/stb_image_write.h>
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <asset/pack_file.h>
+#include <model/mesh_cook.h>
+#include <model/model_asset.h>
+#include <render/gl_extensions.h>
+#include <render/texture_cook.h>
+
+// Cooks assets ahead of time, so the first start of the game does not have to.
+// Run from the directory the game runs in, with the paths the game uses:
+//
+//   cook ../FinalProj
+//   cook ../FinalProj/model/shrub_04_2k.gltf ../FinalProj/road/pavement.jpg
+//
+// Directories are searched recursively. glTF files become cooked meshes, JPEG and PNG
+// images cooked textures with their mip chain, block compressed unless --rgba8 is given.
+// Mesh vertices are quantised like the game loads them, or kept in the glTF's own format
+// with --source-vertices.
+// Results go to the derived data cache the game reads from. Files already cooked with
+// the same contents are left alone.
+//
+//   cook --pack assets.pak ../FinalProj
+//
+// instead bundles the shaders, images and glTF files below the directory into the pack
+// file the game mounts at ../FinalProj, with names relative to the directory.
+static const char *FormatNames[] = { "RGBA8", "BC1", "BC3", "BC5" };
+
+static std::string Extension(const std::string &path)
+{
+	std::string extension = std::filesystem::path(path).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+	return extension;
+}
+
+static bool IsCookable(const std::string &path)
+{
+	std::string extension = Extension(path);
+	return extension == ".gltf" || extension == ".jpg" || extension == ".jpeg" || extension == ".png";
+}
+
+static bool IsPackable(const std::string &path)
+{
+	std::string extension = Extension(path);
+	return IsCookable(path) || extension == ".bin" || extension == ".vert" || extension == ".frag";
+}
+
+static int Pack(const std::string &packPath, int count, char *directories[])
+{
+	std::vector<PackSource> sources;
+	for (int i = 0; i < count; i++)
+	{
+		std::filesystem::path root(directories[i]);
+		for (const std::filesystem::directory_entry &entry : std::filesystem::recursive_directory_iterator(root))
+		{
+			if (entry.is_regular_file() && IsPackable(entry.path().string()))
+			{
+				sources.push_back({ entry.path().lexically_relative(root).generic_string(), entry.path().string() });
+			}
+		}
+	}
+
+	if (!WritePackFile(packPath, sources))
+	{
+		std::cerr << "Failed to write " << packPath << std::endl;
+		return 1;
+	}
+	std::cout << packPath << " (" << sources.size() << " files)" << std::endl;
+	return 0;
+}
+
+static bool CookMeshFile(const std::string &path, const VertexFormat &format)
+{
+	// Decoding maps the cached cook when there is one and cooks the glTF otherwise
+	ModelData data;
+	if (!ModelAsset::decode(path, data, format))
+	{
+		return false;
+	}
+	std::cout << path << " -> " << DerivedDataCache::path(CookedMeshKey(path, format)) << " (" << data.vertexCount
+			  << " vertices, " << data.vertexDataSize << " vertex bytes, " << data.indexCount << " indices, " << data.lodErrors.size()
+			  << " levels of detail)" << std::endl;
+	return true;
+}
+
+static bool CookTextureFile(const std::string &path, bool compress)
+{
+	std::shared_ptr<const CookedImage> cooked = CookTexture(path, compress);
+	if (!cooked)
+	{
+		std::cerr << "Failed to cook " << path << std::endl;
+		return false;
+	}
+	std::cout << path << " -> " << DerivedDataCache::path(CookedTextureKey(path, compress)) << " ("
+			  << FormatNames[cooked->format] << ", " << cooked->levels.size() << " levels)" << std::endl;
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc >= 4 && std::string(argv[1]) == "--pack")
+	{
+		return Pack(argv[2], argc - 3, argv + 3);
+	}
+
+	bool compress = true;
+	VertexFormat format;
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--rgba8")
+		{
+			compress = false;
+		}
+		else if (arg == "--source-vertices")
+		{
+			format.position = POSITION_SOURCE;
+			format.normal = NORMAL_SOURCE;
+			format.texcoord = TEXCOORD_SOURCE;
+		}
+		else if (std::filesystem::is_directory(arg))
+		{
+			for (const std::filesystem::directory_entry &entry : std::filesystem::recursive_directory_iterator(arg))
+			{
+				if (entry.is_regular_file() && IsCookable(entry.path().generic_string()))
+				{
+					paths.push_back(entry.path().generic_string());
+				}
+			}
+		}
+		else
+		{
+			paths.push_back(arg);
+		}
+	}
+
+	if (paths.empty())
+	{
+		std::cerr << "Usage: cook [--rgba8] [--source-vertices] <file.gltf|file.jpg|file.png|directory>..." << std::endl;
+		std::cerr << "       cook --pack <file.pak> <directory>..." << std::endl;
+		return 1;
+	}
+
+	// There is no context here. Model textures are cooked for one with S3TC unless --rgba8
+	// is given, like the images themselves.
+	glExtensions.textureCompressionS3TC = compress;
+
+	int failed = 0;
+	for (const std::string &path : paths)
+	{
+		bool cooked = Extension(path) == ".gltf" ? CookMeshFile(path, format) : CookTextureFile(path, compress);
+		if (!cooked)
+		{
+			failed++;
+		}
+	}
+	return failed == 0 ? 0 : 1;
+}
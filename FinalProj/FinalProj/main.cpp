@@ -2,6 +2,7 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
 #include <cstdlib>
 #include <vector>
 #define STB_IMAGE_IMPLEMENTATION
@@ -11,12 +12,22 @@
 #include <stb/stb_image_write.h>
 #include <iostream>
 #include <skybox/skybox.h>
-#include <building/building.h>
+#include <building/building_batch.h>
+#include <asset/asset_loader.h>
+#include <asset/virtual_file_system.h>
 #include <render/shader.h>
+#include <render/gl_extensions.h>
+#include <render/frame_constants.h>
+#include <render/frustum_culler.h>
+#include <render/occlusion_culler.h>
+#include <render/scene_bvh.h>
+#include <render/texture_manager.h>
+#include <render/upload_context.h>
 #include <road/road.h>
 #include <windmill/blades.h>
 #include <windmill/windmill.h>
 #include <model/model.h>
+#include <model/model_batch.h>
 #define _USE_MATH_DEFINES
 
 
@@ -26,6 +37,7 @@ int windowWidth = 1024;
 int windowHeight = 768;
 static void key_callback(GLFWwindow *window, int key, int scancode, int action, int mode);
 static void mouse_callback(GLFWwindow* window, double xpos, double ypos);
+static void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
 
 // OpenGL camera view parameters
 static glm::vec3 eye_center;
@@ -44,6 +56,13 @@ float yaw = 180.0f, pitch = 0.0f; // Initial orientation angle
 // Rotate cars
 bool rotateCars = false;
 bool moveParkedCar = false;
+
+// Pick the object in the centre of the view
+bool pickObject = false;
+
+// Hierarchy over the culling boxes of the scene, for picking and camera collision
+static SceneBvh sceneBvh;
+static const float cameraRadius = 2.0f;
 // ---------------------------------------------------------------------------------------------------------------------
 
 // Lighting setup
@@ -67,10 +86,7 @@ GLuint colorBufferID;
 GLuint normalBufferID;
 
 // Shader variable IDs
-GLuint depthMapShaders;     // s.vert, s.frag
-GLuint shadowRenderShaders; // s2.vert, s2.frag
 GLuint lightSpaceMatrixID;  // used to transform vertices into light space
-GLuint depthMapID;          // ^ those are stored in depthMapID shadow map
 GLuint mvpMatrixID;         // transforms geometry for rendering
 GLuint lightPositionID;
 GLuint lightIntensityID;
@@ -101,21 +117,14 @@ static void saveDepthTexture(GLuint fbo, std::string filename) {
 	stbi_write_png(filename.c_str(), width, height, channels, img.data(), width * channels);
 }
 
-void renderSceneFromLight(GLuint depthFBO, std::vector<Building> buildings) {
+void renderSceneFromLight(GLuint depthFBO, BuildingBatch &buildings) {
 	// Bind the FBO for rendering the depth map
 	glBindFramebuffer(GL_FRAMEBUFFER, depthFBO);
 	glViewport(0, 0, shadowMapWidth, shadowMapHeight);
 	glClear(GL_DEPTH_BUFFER_BIT);
 
-	// Configure the light-space matrix
-	glm::mat4 lightProjection = glm::ortho(-500.0f, 500.0f, -500.0f, 500.0f, depthNear, depthFar);
-	glm::mat4 lightView = glm::lookAt(globalLightPosition, glm::vec3(10.0f, 0.0f, 10.0f), lightUp);
-	lightSpaceMatrix = lightProjection * lightView;
-
-	// Render depth map
-	for (Building &b : buildings) {
-		b.render_first_pass(lightSpaceMatrix, depthMapShaders, globalLightPosition, globalLightIntensity);
-	}
+	// Render depth map, the light-space matrix comes from the frame uniform buffer
+	buildings.render_first_pass();
 
 	// Unbind FBO
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -155,6 +164,7 @@ int main(void) {
 
 	// Set the mouse callback
 	glfwSetCursorPosCallback(window, mouse_callback);
+	glfwSetMouseButtonCallback(window, mouse_button_callback);
 
 	// Hide cursor and lock its position in the centre
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -166,20 +176,25 @@ int main(void) {
         std::cerr << "Failed to initialize OpenGL context." << std::endl;
         return -1;
     }
+    LoadGLExtensions(glfwGetProcAddress);
 
-	// Prepare shadow map size for shadow mapping. Usually this is the size of the window itself, but on some platforms like Mac this can be 2x the size of the window. Use glfwGetFramebufferSize to get the shadow map size properly.
-	glfwGetFramebufferSize(window, &shadowMapWidth, &shadowMapHeight);
+	// Data files come from the pack built by cook --pack when there is one, else from the source tree
+	VirtualFileSystem::mount("assets.pak", "../FinalProj");
 
-	// Load shaders
-	depthMapShaders = LoadShadersFromFile("../FinalProj/s.vert", "../FinalProj/s.frag");
-	if (depthMapShaders == 0) {
-		std::cerr << "Failed to load depthMap shaders." << std::endl;
-	}
-	shadowRenderShaders = LoadShadersFromFile("../FinalProj/s2.vert", "../FinalProj/s2.frag");
-	if (shadowRenderShaders == 0) {
-		std::cerr << "Failed to load shadowRender shaders." << std::endl;
-	}
+	// Hidden shared context that uploads textures and buffers from its own thread
+	UploadContext uploadContext;
+	uploadContext.initialize(window);
+
+	// Start reading and decoding the model and texture files on worker threads, they are
+	// uploaded as soon as they are decoded and published before the scene is created
+	AssetLoader assets(uploadContext);
+	assets.requestModel("../FinalProj/model/concrete_road_barrier_02_4k.gltf");
+	assets.requestModel("../FinalProj/model/shrub_04_2k.gltf");
+	assets.requestModel("../FinalProj/model/scene2.gltf");
+	assets.requestTexture("../FinalProj/road/pavement.jpg");
 
+	// Prepare shadow map size for shadow mapping. Usually this is the size of the window itself, but on some platforms like Mac this can be 2x the size of the window. Use glfwGetFramebufferSize to get the shadow map size properly.
+	glfwGetFramebufferSize(window, &shadowMapWidth, &shadowMapHeight);
 
 	// Create the FBO
 	GLuint depthFBO;
@@ -215,7 +230,18 @@ int main(void) {
 	}
 
 
+	// Camera and light state shared by every shader program
+	FrameConstantsBuffer frameConstantsBuffer;
+	frameConstantsBuffer.initialize();
+
+	// Configure the light-space matrix, the light does not move
+	glm::mat4 lightProjection = glm::ortho(-500.0f, 500.0f, -500.0f, 500.0f, depthNear, depthFar);
+	glm::mat4 lightView = glm::lookAt(globalLightPosition, glm::vec3(10.0f, 0.0f, 10.0f), lightUp);
+	lightSpaceMatrix = lightProjection * lightView;
+
+
 	// Create objects in the scene
+	assets.finish();
 
 	// Create skybox
     Skybox skybox{};
@@ -226,20 +252,22 @@ int main(void) {
 	road.initialize(glm::vec3(30.0f, 5.0f, 20.0f), glm::vec3(4, 0, 6), "../FinalProj/road/pavement.jpg");
 
 	// Create inner buildings and intersection
-	std::vector<Building> buildings;
+	BuildingBatch buildings;
 
 	int gridSizeX = 4;          // Number of buildings along x-axis
 	int gridSizeZ = 8;          // Number of buildings along z-axis
 	float spacing = 50.0f;      // Spacing between buildings
 	float outerSpacing = 60.0f; // Spacing between buildings
 
-	// Textures
-	const char* textures[] = {
+	// Textures, one layer each of the building texture array
+	buildings.initialize({
 		"../FinalProj/building/modern0.jpg",
 		"../FinalProj/building/modern1.jpg",
 		"../FinalProj/building/modern2.jpg",
-		"../FinalProj/building/modern3.jpg"
-	};
+		"../FinalProj/building/modern3.jpg",
+		"../FinalProj/building/white.jpg"
+	});
+	const int whiteTextureLayer = 4;
 
 	float constant = 75.0f;
 	for (int i = 0; i < gridSizeX; ++i) {
@@ -259,9 +287,7 @@ int main(void) {
 			// Select random building texture
 			int textureIndex = rand() % 4;
 
-			Building b;
-			b.initialize(glm::vec3(posX, 0.0f, posZ), glm::vec3(width, height, depth), textures[textureIndex]);
-			buildings.push_back(b);
+			buildings.add(glm::vec3(posX, 0.0f, posZ), glm::vec3(width, height, depth), textureIndex);
 		}
 	}
 
@@ -284,9 +310,7 @@ int main(void) {
 			float posZ = j * outerSpacing - (gridSizeZ * spacing) / 2.0f;
 
 			int textureIndex = rand() % 4;
-			Building b;
-			b.initialize(glm::vec3(posX, 0.0f, posZ), glm::vec3(width, height, depth), textures[textureIndex]);
-			buildings.push_back(b);
+			buildings.add(glm::vec3(posX, 0.0f, posZ), glm::vec3(width, height, depth), textureIndex);
 		}
 	}
 
@@ -297,9 +321,7 @@ int main(void) {
 	Blades blades;
 	blades.initialize(glm::vec3(10.0f, 500.0f, 20.0f), glm::vec3(80.0f, 80.0f, 80.0f));
 
-	Building b;
-	b.initialize(glm::vec3(10.0f, 495.0f, 10.0f), glm::vec3(6.0f, 6.0f, 20.0f), "../FinalProj/building/white.jpg");
-	buildings.push_back(b);
+	buildings.add(glm::vec3(10.0f, 495.0f, 10.0f), glm::vec3(6.0f, 6.0f, 20.0f), whiteTextureLayer);
 
 
 	// Create boulder
@@ -313,68 +335,103 @@ int main(void) {
 	boulder.setRotation(90, glm::vec3(0.0f, 1.0f, 0.0f));
 	boulder.setRotation(275, glm::vec3(1.0f, 0.0f, 0.0f));
 
-	// Create trees
-	Model tree;
-	if (!tree.loadModel("../FinalProj/model/shrub_04_2k.gltf")) {
+	// Create trees, all placements of the shrub are drawn in one instanced call
+	ModelBatch trees;
+	if (!trees.loadModel("../FinalProj/model/shrub_04_2k.gltf")) {
 		std::cerr << "Failed to load model!" << std::endl;
 		return -1;
 	}
+
+	ModelInstance tree = trees.addInstance();
 	tree.setPosition(glm::vec3(290, -10.0f, 400));
 	tree.setScale(glm::vec3(1000.0f));
 
-	Model tree2;
-	if (!tree2.loadModel("../FinalProj/model/shrub_04_2k.gltf")) {
-		std::cerr << "Failed to load model!" << std::endl;
-		return -1;
-	}
+	ModelInstance tree2 = trees.addInstance();
 	tree2.setPosition(glm::vec3(-120, -10.0f, 420));
 	tree2.setRotation(180, glm::vec3(0.0f, 1.0f, 0.0f));
 	tree2.setScale(glm::vec3(800.0f));
 
-	Model tree3;
-	if (!tree3.loadModel("../FinalProj/model/shrub_04_2k.gltf")) {
-		std::cerr << "Failed to load model!" << std::endl;
-		return -1;
-	}
+	ModelInstance tree3 = trees.addInstance();
 	tree3.setPosition(glm::vec3(290, -10.0f, -360));
 	tree3.setScale(glm::vec3(1000.0f));
 
-	Model tree4;
-	if (!tree4.loadModel("../FinalProj/model/shrub_04_2k.gltf")) {
-		std::cerr << "Failed to load model!" << std::endl;
-		return -1;
-	}
+	ModelInstance tree4 = trees.addInstance();
 	tree4.setPosition(glm::vec3(-190, -10.0f, -380));
 	tree4.setRotation(180, glm::vec3(0.0f, 1.0f, 0.0f));
 	tree4.setScale(glm::vec3(1000.0f));
 
+	// Far shrubs are single quads
+	if (!trees.enableImpostor(900.0f)) {
+		std::cerr << "Failed to bake shrub impostor" << std::endl;
+	}
+
 
 	// Create cars
-	Model car1;
-	if (!car1.loadModel("../FinalProj/model/scene2.gltf")) {
+	ModelBatch cars;
+	if (!cars.loadModel("../FinalProj/model/scene2.gltf")) {
 		std::cerr << "Failed to load model!" << std::endl;
 		return -1;
 	}
+
+	ModelInstance car1 = cars.addInstance();
 	car1.setPosition(glm::vec3(-400, 200.0f, -800));
 	car1.setScale(glm::vec3(20.0f));
 
-	Model car2;
-	if (!car2.loadModel("../FinalProj/model/scene2.gltf")) {
-		std::cerr << "Failed to load model!" << std::endl;
-		return -1;
-	}
+	ModelInstance car2 = cars.addInstance();
 	car2.setPosition(glm::vec3(800, 200.0f, -100.0f));
 	car2.setRotation(270, glm::vec3(0.0f, 1.0f, 0.0f));
 	car2.setScale(glm::vec3(20.0f));
 
-	Model car3;
-	if (!car3.loadModel("../FinalProj/model/scene2.gltf")) {
-		std::cerr << "Failed to load model!" << std::endl;
-		return -1;
-	}
+	ModelInstance car3 = cars.addInstance();
 	car3.setPosition(glm::vec3(-285, -32.0f, 285.0f));
 	car3.setScale(glm::vec3(20.0f));
 
+	if (!cars.enableImpostor(600.0f)) {
+		std::cerr << "Failed to bake car impostor" << std::endl;
+	}
+
+	// Every preloaded asset now has an owner in the scene
+	assets.release();
+
+	// World boxes of everything drawn, tested against each pass's frustum every frame
+	FrustumCuller culler;
+	buildings.attachCulling(culler);
+	boulder.attachCulling(culler);
+	trees.attachCulling(culler);
+	cars.attachCulling(culler);
+
+	glm::vec3 boundsMin, boundsMax;
+	CullRange windmillBox = culler.add(1);
+	windmill.bounds(boundsMin, boundsMax);
+	culler.set(windmillBox.first, boundsMin, boundsMax);
+	CullRange bladesBox = culler.add(1);
+	blades.bounds(boundsMin, boundsMax);
+	culler.set(bladesBox.first, boundsMin, boundsMax);
+
+	// Buildings hide whatever stands behind them from the camera, tested at a quarter of the window size
+	OcclusionCuller occlusion;
+	occlusion.initialize(windowWidth / 4, windowHeight / 4);
+	CullRange buildingBoxes = buildings.instanceBoxes;
+	occlusion.addOccluders(buildingBoxes);
+
+	// Only what is drawn, the building clusters are left out
+	struct PickTarget
+	{
+		CullRange boxes;
+		const char *name;
+	};
+	std::vector<PickTarget> pickTargets = {
+		{ buildingBoxes, "building" },
+		{ boulder.box(), "boulder" },
+		{ trees.boxes(), "tree" },
+		{ cars.boxes(), "car" },
+		{ windmillBox, "windmill" },
+		{ bladesBox, "blades" }
+	};
+	std::vector<CullRange> pickRanges;
+	for (const PickTarget &target : pickTargets) pickRanges.push_back(target.boxes);
+	sceneBvh.build(culler, pickRanges);
+
 
 	// Camera setup
 	eye_center = glm::vec3(400.0f, 400.0f, 600.0f);
@@ -393,16 +450,13 @@ int main(void) {
 	glEnable(GL_DEPTH_TEST);
     do
     {
-    	// Render from the light's perspective to generate depth map
-    	renderSceneFromLight(depthFBO, buildings);
-
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
     	// Update time
     	double currentTime = glfwGetTime();
     	float deltaTime = float(currentTime - lastTime);
     	lastTime = currentTime;
 
+    	// Publish any streamed assets whose upload has completed
+    	assets.update();
 
         viewMatrix = glm::lookAt(eye_center, lookat, up);
 
@@ -415,6 +469,43 @@ int main(void) {
     	// Create a combined VP matrix for the buildings
     	glm::mat4 vp = projectionMatrix * viewMatrix;
 
+    	// Upload camera and light state once for every program this frame
+    	FrameConstants frameConstants;
+    	frameConstants.viewProjection = vp;
+    	frameConstants.lightSpaceMatrix = lightSpaceMatrix;
+    	frameConstants.lightPosition = glm::vec4(globalLightPosition, 1.0f);
+    	frameConstants.lightIntensity = glm::vec4(globalLightIntensity, 0.0f);
+    	frameConstants.viewPosition = glm::vec4(eye_center, 1.0f);
+    	frameConstantsBuffer.update(frameConstants);
+
+    	// Buildings added since the last frame have moved to new boxes, the old ones are empty
+    	if (buildings.instanceBoxes.first != buildingBoxes.first || buildings.instanceBoxes.count != buildingBoxes.count) {
+    		buildingBoxes = buildings.instanceBoxes;
+    		occlusion.clearOccluders();
+    		occlusion.addOccluders(buildingBoxes);
+    		pickTargets[0].boxes = pickRanges[0] = buildingBoxes;
+    		sceneBvh.build(culler, pickRanges);
+    	}
+
+    	// Boxes of whatever moved, then what the light and the camera can see
+    	boulder.updateBounds();
+    	trees.updateBounds();
+    	cars.updateBounds();
+    	sceneBvh.refit(culler);
+    	culler.cull(CULL_PASS_SHADOW, lightSpaceMatrix);
+    	culler.cull(CULL_PASS_CAMERA, vp);
+    	occlusion.cull(culler, vp, eye_center);
+    	const CullResult &cameraCull = culler.result(CULL_PASS_CAMERA);
+
+    	// Models pick their level of detail from their size on screen, far city blocks their proxies
+    	LodView lodView(eye_center, glm::radians(FoV), float(windowHeight), zFar);
+    	buildings.update(lodView);
+
+    	// Render from the light's perspective to generate depth map
+    	renderSceneFromLight(depthFBO, buildings);
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
     	if (saveDepth) {
     		std::string filename = "depth_camera.png";
     		saveDepthTexture(depthFBO, filename);
@@ -434,33 +525,18 @@ int main(void) {
     	road.render(vp);
 
     	// Render buildings
-    	 for (Building& b : buildings) {
-    	 	glUseProgram(shadowRenderShaders);
-    	 	glUniform3fv(glGetUniformLocation(shadowRenderShaders, "lightPosition"), 1, &globalLightPosition[0]);
-    	 	glUniform3fv(glGetUniformLocation(shadowRenderShaders, "lightIntensity"), 1, &globalLightIntensity[0]);
-    	 	glUniform3fv(glGetUniformLocation(shadowRenderShaders, "viewPosition"), 1, &eye_center[0]);
-    	 	glUniformMatrix4fv(glGetUniformLocation(shadowRenderShaders, "lightSpaceMatrix"), 1, GL_FALSE, &lightSpaceMatrix[0][0]);
-    	 	depthMapID = glGetUniformLocation(shadowRenderShaders, "depthMap");
-    	 	glUniform1i(depthMapID, depthFBO);
-
-    	 	b.render_second_pass(vp, shadowRenderShaders);
-    	 }
+    	buildings.render_second_pass();
 
     	// Render boulder
-    	boulder.render(vp, eye_center);
+    	boulder.render(lodView);
 
     	// Render trees
-    	tree.render(vp, eye_center);
-    	tree2.render(vp, eye_center);
-    	tree3.render(vp, eye_center);
-    	tree4.render(vp, eye_center);
+    	trees.render(lodView);
 
     	// Render cars
-    	car1.render(vp, eye_center);
+    	cars.render(lodView);
     	car1.translate(glm::vec3(0.0f,0.0f, 0.05f));
-    	car2.render(vp, eye_center);
     	car2.translate(glm::vec3(0.0f,0.0f, 0.02f));
-    	car3.render(vp, eye_center);
 
     	if (rotateCars) {
     		car1.setRotation(180.0f, glm::vec3(0.0f, 1.0f, 0.0f));
@@ -472,10 +548,29 @@ int main(void) {
     		car3.translate(glm::vec3(0.0f,0.0f, 0.03f));
     	}
 
+    	if (pickObject) {
+    		SceneBvh::RayHit hit;
+    		if (sceneBvh.raycast(eye_center, glm::normalize(lookat - eye_center), zFar, hit)) {
+    			for (const PickTarget &target : pickTargets) {
+    				if (hit.box >= target.boxes.first && hit.box < target.boxes.first + target.boxes.count) {
+    					std::cout << "Picked " << target.name << " " << hit.box - target.boxes.first
+    							  << " at distance " << hit.distance << std::endl;
+    				}
+    			}
+    		} else {
+    			std::cout << "Picked nothing" << std::endl;
+    		}
+    		pickObject = false;
+    	}
+
 
     	// Render spire
-    	windmill.render(vp);
-    	blades.render(vp);
+    	if (cameraCull.contains(windmillBox.first)) {
+    		windmill.render();
+    	}
+    	if (cameraCull.contains(bladesBox.first)) {
+    		blades.render();
+    	}
 
 
     	// FPS tracking
@@ -488,7 +583,11 @@ int main(void) {
     		fTime = 0;
 
     		std::stringstream stream;
-    		stream << std::fixed << std::setprecision(2) << "Final Project | (FPS): " << fps;
+    		const CullResult &shadowCull = culler.result(CULL_PASS_SHADOW);
+    		stream << std::fixed << std::setprecision(2) << "Final Project | (FPS): " << fps
+    			   << " | Culled: shadow " << shadowCull.culled << "/" << shadowCull.tested
+    			   << ", camera " << cameraCull.culled << "/" << cameraCull.tested
+    			   << " (" << cameraCull.occluded << " occluded)";
     		glfwSetWindowTitle(window, stream.str().c_str());
     	}
 
@@ -503,13 +602,15 @@ int main(void) {
 
     // Clean up
     skybox.cleanup();
-	for(Building b : buildings) {
-		b.cleanup();
-	}
+	buildings.cleanup();
 	road.cleanup();
 	skybox.cleanup();
 	windmill.cleanup();
 	blades.cleanup();
+	frameConstantsBuffer.cleanup();
+	uploadContext.cleanup();
+	TextureManager::shutdown();
+	VirtualFileSystem::unmountAll();
 
 
     // Close OpenGL window and terminate GLFW
@@ -517,6 +618,17 @@ int main(void) {
     return 0;
 }
 
+// True when the camera moving from from to to would enter an object it is not already in
+static bool cameraBlocked(const glm::vec3 &from, const glm::vec3 &to) {
+	std::vector<uint32_t> before, after;
+	sceneBvh.query(from, cameraRadius, before);
+	sceneBvh.query(to, cameraRadius, after);
+	for (uint32_t box : after) {
+		if (std::find(before.begin(), before.end(), box) == before.end()) return true;
+	}
+	return false;
+}
+
 // Is called whenever a key is pressed/released via GLFW
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mode) {
 	// Speed of movement
@@ -528,26 +640,29 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
 	// Calculate the right vector (perpendicular to lookDirection and up)
 	glm::vec3 rightDirection = glm::normalize(glm::cross(lookDirection, up));
 
+	glm::vec3 movement(0.0f);
     if (key == GLFW_KEY_W && (action == GLFW_REPEAT || action == GLFW_PRESS)) {
-    	eye_center += lookDirection * speed;
-    	lookat += lookDirection * speed; // Move look-at point to keep orientation
+    	movement += lookDirection * speed;
     }
 
     if (key == GLFW_KEY_S && (action == GLFW_REPEAT || action == GLFW_PRESS)) {
-    	eye_center -= lookDirection * speed;
-    	lookat -= lookDirection * speed; // Move look-at point to keep orientation
+    	movement -= lookDirection * speed;
     }
 
     if (key == GLFW_KEY_A && (action == GLFW_REPEAT || action == GLFW_PRESS)) {
-    	eye_center -= rightDirection * speed;
-    	lookat -= rightDirection * speed; // Move look-at point to keep orientation
+    	movement -= rightDirection * speed;
     }
 
     if (key == GLFW_KEY_D && (action == GLFW_REPEAT || action == GLFW_PRESS)) {
-    	eye_center += rightDirection * speed;
-    	lookat += rightDirection * speed; // Move look-at point to keep orientation
+    	movement += rightDirection * speed;
     }
 
+	// Move look-at point along to keep orientation, unless the camera would run into something
+	if (movement != glm::vec3(0.0f) && !cameraBlocked(eye_center, eye_center + movement)) {
+		eye_center += movement;
+		lookat += movement;
+	}
+
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, GL_TRUE);
 
@@ -584,4 +699,9 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
 	front.y = sin(glm::radians(pitch));
 	front.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
 	lookat = eye_center + glm::normalize(front);
-}
\ No newline at end of file
+}
+
+void mouse_button_callback(GLFWwindow*, int button, int action, int) {
+	if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
+		pickObject = true;
+}
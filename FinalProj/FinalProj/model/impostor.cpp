@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+#include "impostor.h"
+#include "model.h"
+
+// Mip levels of the atlases, so the smallest frame still has 16 pixels a side
+static const int ImpostorMipLevels = 4;
+
+// Same mapping as octahedralDecode in impostor.vert, folded over y
+static glm::vec3 octahedralDecode(const glm::vec2& uv) {
+    glm::vec3 d(uv.x, 1.0f - std::abs(uv.x) - std::abs(uv.y), uv.y);
+    float fold = std::max(-d.y, 0.0f);
+    d.x += d.x >= 0.0f ? -fold : fold;
+    d.z += d.z >= 0.0f ? -fold : fold;
+    return glm::normalize(d);
+}
+
+// Up vector of the frame looking from direction, as impostor.vert picks it
+static glm::vec3 frameUp(const glm::vec3& direction) {
+    return std::abs(direction.y) > 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+}
+
+static GLuint createAtlas() {
+    GLsizei size = IMPOSTOR_FRAMES * IMPOSTOR_FRAME_SIZE;
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, ImpostorMipLevels - 1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+Impostor::Impostor() {
+    program.reflect(LoadShadersFromFile("../FinalProj/model/impostor.vert", "../FinalProj/model/impostor.frag"));
+    if (!program.valid()) {
+        std::cerr << "Failed to load impostor shaders." << std::endl;
+    }
+    boundsCentreUniform = program.uniform("boundsCentre");
+    boundsRadiusUniform = program.uniform("boundsRadius");
+    framesUniform = program.uniform("frames");
+    impostorFadeUniform = program.uniform("impostorFade");
+    colorUniform = program.uniform("impostorColor");
+    normalDepthUniform = program.uniform("impostorNormalDepth");
+
+    // One quad, corners in [-1, 1]^2, and the instance transforms of the caller's buffer at 3-6
+    static const GLfloat corners[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+    glGenBuffers(1, &quadVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+    for (GLuint i = 0; i < 4; i++) {
+        glEnableVertexAttribArray(3 + i);
+        glVertexAttribDivisor(3 + i, 1);
+    }
+    glBindVertexArray(0);
+}
+
+Impostor::~Impostor() {
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &quadVBO);
+    glDeleteTextures(1, &colorTexture);
+    glDeleteTextures(1, &normalDepthTexture);
+    ReleaseShaders(program.id());
+}
+
+bool Impostor::bake(const ModelAsset& asset, const NodeHierarchy& nodes) {
+    ShaderProgram bakeProgram(LoadShadersFromFile("../FinalProj/model/impostor_bake.vert",
+                                                  "../FinalProj/model/impostor_bake.frag"));
+    if (!bakeProgram.valid()) {
+        std::cerr << "Failed to load impostor bake shaders." << std::endl;
+        return false;
+    }
+    ModelUniforms uniforms;
+    uniforms.locate(bakeProgram);
+
+    boundsCentre = (asset.boundsMin + asset.boundsMax) * 0.5f;
+    boundsRadius = std::max(glm::length(asset.boundsMax - asset.boundsMin) * 0.5f, 1e-6f);
+
+    if (!colorTexture) {
+        colorTexture = createAtlas();
+        normalDepthTexture = createAtlas();
+    }
+    GLsizei size = IMPOSTOR_FRAMES * IMPOSTOR_FRAME_SIZE;
+    GLuint depthBuffer;
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size, size);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    GLuint FBO;
+    glGenFramebuffers(1, &FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normalDepthTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    const GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, drawBuffers);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+    if (complete) {
+        // The caller's viewport, clear color and depth test come back afterwards
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        GLfloat clearColor[4];
+        glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+
+        glEnable(GL_DEPTH_TEST);
+        glViewport(0, 0, size, size);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        bakeProgram.use();
+        ShaderProgram::set(bakeProgram.uniform("boundsCentre"), boundsCentre);
+        ShaderProgram::set(bakeProgram.uniform("boundsRadius"), boundsRadius);
+        GLint viewProjection = bakeProgram.uniform("viewProjection");
+        GLint frameDirection = bakeProgram.uniform("frameDirection");
+
+        // Frame (i, j) looks from the direction at the centre of its cell of the octahedral map,
+        // just framing the bounding sphere
+        glm::mat4 projection = glm::ortho(-boundsRadius, boundsRadius, -boundsRadius, boundsRadius,
+                                          boundsRadius, 3.0f * boundsRadius);
+        glBindVertexArray(asset.VAO);
+        for (int j = 0; j < IMPOSTOR_FRAMES; j++) {
+            for (int i = 0; i < IMPOSTOR_FRAMES; i++) {
+                glm::vec2 uv = (glm::vec2(i, j) + 0.5f) / float(IMPOSTOR_FRAMES) * 2.0f - 1.0f;
+                glm::vec3 direction = octahedralDecode(uv);
+                glm::mat4 view = glm::lookAt(boundsCentre + direction * 2.0f * boundsRadius, boundsCentre,
+                                             frameUp(direction));
+                ShaderProgram::set(viewProjection, projection * view);
+                ShaderProgram::set(frameDirection, direction);
+                glViewport(i * IMPOSTOR_FRAME_SIZE, j * IMPOSTOR_FRAME_SIZE, IMPOSTOR_FRAME_SIZE, IMPOSTOR_FRAME_SIZE);
+                uniforms.drawSubmeshes(asset, nodes, glm::mat4(1.0f));
+            }
+        }
+        glBindVertexArray(0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glUseProgram(0);
+
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+        if (!depthTest) {
+            glDisable(GL_DEPTH_TEST);
+        }
+    } else {
+        std::cerr << "Impostor framebuffer is incomplete." << std::endl;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &FBO);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    ReleaseShaders(bakeProgram.id());
+    if (!complete) {
+        return false;
+    }
+
+    for (GLuint texture : { colorTexture, normalDepthTexture }) {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+}
+
+void Impostor::render(GLuint instanceVBO, size_t first, GLsizei count, const glm::vec2& fade) {
+    if (!colorTexture || count == 0) return;
+
+    program.use();
+    ShaderProgram::set(boundsCentreUniform, boundsCentre);
+    ShaderProgram::set(boundsRadiusUniform, boundsRadius);
+    ShaderProgram::set(framesUniform, float(IMPOSTOR_FRAMES));
+    ShaderProgram::set(impostorFadeUniform, fade);
+
+    // Unit 1 holds the shadow map, the atlases go next to the base color unit
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+    ShaderProgram::set(colorUniform, 0);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, normalDepthTexture);
+    ShaderProgram::set(normalDepthUniform, 2);
+
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    for (GLuint i = 0; i < 4; i++) {
+        size_t offset = first * sizeof(glm::mat4) + sizeof(glm::vec4) * i;
+        glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)offset);
+    }
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+    glBindVertexArray(0);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+}
@@ -0,0 +1,55 @@
+#version 330 core
+
+in vec3 FragPos;
+in vec2 TexCoords;
+in float Fade;
+flat in vec3 FrameDepth;
+flat in mat3 NormalMatrix;
+
+layout(std140) uniform FrameConstants {
+    mat4 viewProjection;
+    mat4 lightSpaceMatrix;
+    vec4 lightPosition;
+    vec4 lightIntensity;
+    vec4 viewPosition;
+};
+
+uniform sampler2D impostorColor;
+uniform sampler2D impostorNormalDepth;
+
+out vec4 FragColor;
+
+// Same noise as model.frag, so mesh and impostor together cover every pixel once
+float ditherNoise() {
+    return fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+}
+
+void main() {
+    if (ditherNoise() >= Fade) {
+        discard;
+    }
+
+    vec4 color = texture(impostorColor, TexCoords);
+    if (color.a < 0.5) {
+        discard;
+    }
+    // Mipmaps average with the empty background, undo the darkening
+    vec3 baseColor = color.rgb / color.a;
+
+    // Surface point and normal of the baked mesh, so the impostor intersects and lights like it
+    vec4 normalDepth = texture(impostorNormalDepth, TexCoords);
+    vec3 normal = normalize(NormalMatrix * (normalDepth.xyz * 2.0 - 1.0));
+    vec3 position = FragPos + FrameDepth * (normalDepth.a * 2.0 - 1.0);
+    vec4 clip = viewProjection * vec4(position, 1.0);
+    gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+
+    // Lighting as in model.frag
+    vec3 lightDir = normalize(lightPosition.xyz - position);
+    vec3 viewDir = normalize(viewPosition.xyz - position);
+    vec3 reflectDir = reflect(-lightDir, normal);
+    vec3 ambient = 0.2 * lightIntensity.rgb;
+    vec3 diffuse = max(dot(normal, lightDir), 0.0) * lightIntensity.rgb;
+    vec3 specular = 0.5 * pow(max(dot(viewDir, reflectDir), 0.0), 32) * lightIntensity.rgb;
+
+    FragColor = vec4((ambient + diffuse + specular) * baseColor, 1.0);
+}
@@ -0,0 +1,43 @@
+#ifndef IMPOSTOR_H
+#define IMPOSTOR_H
+
+#include <glm/glm.hpp>
+#include "glad/gl.h"
+#include "model_asset.h"
+#include <render/shader.h>
+
+// Frames along each side of an impostor atlas, and pixels along each side of a frame
+const int IMPOSTOR_FRAMES = 8;
+const int IMPOSTOR_FRAME_SIZE = 128;
+
+// Octahedral impostor of a model asset. The asset is rendered once, orthographically, from
+// IMPOSTOR_FRAMES^2 directions spread over the sphere by an octahedral mapping, into a color
+// atlas and a normal and depth atlas. Far away, each instance is then one quad showing the
+// frame baked closest to its view direction, lit from the baked normals and written at the
+// baked depth.
+class Impostor {
+public:
+    Impostor();
+    ~Impostor();
+    Impostor(const Impostor&) = delete;
+    Impostor& operator=(const Impostor&) = delete;
+
+    // Renders asset, posed by nodes, into the atlases. Render thread only, the asset must have
+    // been published. Returns false when the framebuffer cannot be created.
+    bool bake(const ModelAsset& asset, const NodeHierarchy& nodes);
+
+    // Draws count instances whose transforms sit in instanceVBO from mat4 first on. Instances
+    // fade in over fade, distances from the camera, as their meshes fade out.
+    void render(GLuint instanceVBO, size_t first, GLsizei count, const glm::vec2& fade);
+
+private:
+    ShaderProgram program;
+    GLint boundsCentreUniform, boundsRadiusUniform, framesUniform, impostorFadeUniform;
+    GLint colorUniform, normalDepthUniform;
+    GLuint VAO = 0, quadVBO = 0;
+    GLuint colorTexture = 0, normalDepthTexture = 0;
+    glm::vec3 boundsCentre = glm::vec3(0.0f);
+    float boundsRadius = 0.0f;
+};
+
+#endif
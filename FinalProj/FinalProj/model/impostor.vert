@@ -0,0 +1,72 @@
+#version 330 core
+
+layout (location = 0) in vec2 inCorner;
+layout (location = 3) in mat4 instanceModel;
+
+layout(std140) uniform FrameConstants {
+    mat4 viewProjection;
+    mat4 lightSpaceMatrix;
+    vec4 lightPosition;
+    vec4 lightIntensity;
+    vec4 viewPosition;
+};
+
+// Bounding sphere of the asset in model space, which each atlas frame exactly covers
+uniform vec3 boundsCentre;
+uniform float boundsRadius;
+uniform float frames;           // Frames along each side of the atlas
+
+// Fades in between impostorFade.x and .y from the camera, as the mesh fades out
+uniform vec2 impostorFade;
+
+out vec3 FragPos;
+out vec2 TexCoords;
+out float Fade;
+flat out vec3 FrameDepth;       // World space offset of the surface baked at depth 1
+flat out mat3 NormalMatrix;
+
+// Octahedral mapping of the sphere of directions onto [-1, 1]^2, folded over y
+vec2 octahedralEncode(vec3 d) {
+    d /= abs(d.x) + abs(d.y) + abs(d.z);
+    vec2 uv = d.xz;
+    if (d.y < 0.0) {
+        uv = (1.0 - abs(d.zx)) * vec2(d.x >= 0.0 ? 1.0 : -1.0, d.z >= 0.0 ? 1.0 : -1.0);
+    }
+    return uv;
+}
+
+vec3 octahedralDecode(vec2 uv) {
+    vec3 d = vec3(uv.x, 1.0 - abs(uv.x) - abs(uv.y), uv.y);
+    float fold = max(-d.y, 0.0);
+    d.x += d.x >= 0.0 ? -fold : fold;
+    d.z += d.z >= 0.0 ? -fold : fold;
+    return normalize(d);
+}
+
+void main() {
+    vec3 centre = vec3(instanceModel * vec4(boundsCentre, 1.0));
+    mat3 linear = mat3(instanceModel);
+
+    // The frame baked closest to the direction the camera sees the instance from
+    vec3 toCamera = inverse(linear) * (viewPosition.xyz - centre);
+    vec2 uv = octahedralEncode(normalize(toCamera)) * 0.5 + 0.5;
+    vec2 frame = clamp(floor(uv * frames), 0.0, frames - 1.0);
+    vec3 direction = octahedralDecode((frame + 0.5) / frames * 2.0 - 1.0);
+
+    // The quad lies in the frame's image plane, with the basis glm::lookAt gave the bake
+    vec3 forward = -direction;
+    vec3 up = abs(direction.y) > 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+    vec3 right = normalize(cross(forward, up));
+    up = cross(right, forward);
+    vec3 position = boundsCentre + (right * inCorner.x + up * inCorner.y) * boundsRadius;
+
+    vec4 worldPos = instanceModel * vec4(position, 1.0);
+    FragPos = vec3(worldPos);
+    gl_Position = viewProjection * worldPos;
+    TexCoords = (frame + inCorner * 0.5 + 0.5) / frames;
+    FrameDepth = linear * direction * boundsRadius;
+    NormalMatrix = transpose(inverse(linear));
+
+    float cameraDistance = length(viewPosition.xyz - centre);
+    Fade = clamp((cameraDistance - impostorFade.x) / max(impostorFade.y - impostorFade.x, 1e-4), 0.0, 1.0);
+}
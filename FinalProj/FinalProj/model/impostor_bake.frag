@@ -0,0 +1,27 @@
+#version 330 core
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+uniform vec3 objectColor;
+uniform sampler2D modelTexture;
+uniform bool hasTexture;
+
+// Frame being baked: the direction it looks from, and the bounding sphere it frames
+uniform vec3 frameDirection;
+uniform vec3 boundsCentre;
+uniform float boundsRadius;
+
+layout (location = 0) out vec4 OutColor;
+layout (location = 1) out vec4 OutNormalDepth;
+
+void main() {
+    // Unlit base color, the impostor is lit when drawn
+    vec3 baseColor = hasTexture ? texture(modelTexture, TexCoords).rgb : objectColor;
+    OutColor = vec4(baseColor, 1.0);
+
+    // Model space normal, and how far towards the viewer the surface lies from the bounds centre
+    float depth = dot(FragPos - boundsCentre, frameDirection) / boundsRadius;
+    OutNormalDepth = vec4(normalize(Normal) * 0.5 + 0.5, depth * 0.5 + 0.5);
+}
@@ -0,0 +1,41 @@
+#version 330 core
+
+layout (location = 0) in vec3 inPosition;
+layout (location = 1) in vec3 inNormal;
+layout (location = 2) in vec2 inTexCoords;
+
+// Orthographic view of one atlas frame, not the camera of the FrameConstants block
+uniform mat4 viewProjection;
+uniform mat4 model;
+
+// Undoes the vertex quantisation, see VertexDecoding
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+uniform vec2 texcoordOffset;
+uniform vec2 texcoordScale;
+uniform bool octahedralNormals;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+vec3 decodeNormal(vec3 stored) {
+    if (!octahedralNormals) {
+        return stored;
+    }
+    vec3 n = vec3(stored.xy, 1.0 - abs(stored.x) - abs(stored.y));
+    float fold = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -fold : fold;
+    n.y += n.y >= 0.0 ? -fold : fold;
+    return normalize(n);
+}
+
+void main() {
+    vec3 position = positionOffset + positionScale * inPosition;
+
+    // Model space, the node transform is the only one
+    FragPos = vec3(model * vec4(position, 1.0));
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
+    Normal = mat3(transpose(inverse(model))) * decodeNormal(inNormal);
+    TexCoords = texcoordOffset + texcoordScale * inTexCoords;
+}
@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <asset/virtual_file_system.h>
+#include "mesh_cook.h"
+
+static const uint64_t CookedBlockAlignment = 16;
+
+static uint64_t alignBlock(uint64_t offset) {
+    return (offset + CookedBlockAlignment - 1) / CookedBlockAlignment * CookedBlockAlignment;
+}
+
+static std::string directoryOf(const std::string& path) {
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+DerivedDataKey CookedMeshKey(const std::string& sourcePath, const VertexFormat& format) {
+    DerivedDataKey key("mesh", COOKED_MESH_VERSION);
+    key.add(sourcePath).add(uint64_t(format.position)).add(uint64_t(format.normal)).add(uint64_t(format.texcoord));
+
+    VirtualFile file = VirtualFileSystem::open(sourcePath);
+    if (!file.valid()) {
+        return key.addFile(sourcePath);
+    }
+    std::string json = file.text();
+    key.add(json);
+
+    // Buffers and images referenced by file, found by a plain scan of the JSON.
+    // data: URIs are part of the glTF already.
+    size_t at = 0;
+    while ((at = json.find("\"uri\"", at)) != std::string::npos) {
+        size_t open = json.find('"', json.find(':', at + 5));
+        size_t close = open == std::string::npos ? open : json.find('"', open + 1);
+        if (close == std::string::npos) {
+            break;
+        }
+        std::string uri = json.substr(open + 1, close - open - 1);
+        if (uri.compare(0, 5, "data:") != 0) {
+            key.addOptionalFile(directoryOf(sourcePath) + uri);
+        }
+        at = close + 1;
+    }
+    return key;
+}
+
+bool WriteCookedMesh(const DerivedDataKey& key, const ModelData& data) {
+    std::string strings;
+    std::vector<CookedMeshMaterial> materials;
+    for (const MaterialData& material : data.materials) {
+        if (material.texturePath.empty() && material.texture.valid()) {
+            return true;
+        }
+        materials.push_back({ strings.size(), material.texturePath.size() });
+        strings += material.texturePath;
+    }
+    std::vector<CookedMeshNode> nodes(data.nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++) {
+        CookedMeshNode& node = nodes[i];
+        int index = static_cast<int>(i);
+        node.parent = data.nodes.parent(index);
+        memcpy(node.translation, &data.nodes.translation(index)[0], sizeof(node.translation));
+        const glm::quat& rotation = data.nodes.rotation(index);
+        node.rotation[0] = rotation.w;
+        node.rotation[1] = rotation.x;
+        node.rotation[2] = rotation.y;
+        node.rotation[3] = rotation.z;
+        memcpy(node.scale, &data.nodes.scale(index)[0], sizeof(node.scale));
+        node.nameOffset = strings.size();
+        node.nameLength = data.nodes.name(index).size();
+        strings += data.nodes.name(index);
+    }
+
+    CookedMeshHeader header = {};
+    header.magic = COOKED_MESH_MAGIC;
+    header.version = COOKED_MESH_VERSION;
+    header.vertexCount = static_cast<uint32_t>(data.vertexCount);
+    header.indexCount = static_cast<uint32_t>(data.indexCount);
+    header.indexType = data.indexType;
+    header.submeshCount = static_cast<uint32_t>(data.submeshes.size());
+    header.materialCount = static_cast<uint32_t>(materials.size());
+    header.nodeCount = static_cast<uint32_t>(nodes.size());
+    header.lodCount = static_cast<uint32_t>(data.lodErrors.size());
+    header.meshLodCount = static_cast<uint32_t>(data.lods.size());
+    memcpy(header.boundsMin, &data.boundsMin[0], sizeof(header.boundsMin));
+    memcpy(header.boundsMax, &data.boundsMax[0], sizeof(header.boundsMax));
+    std::copy(data.streams, data.streams + MODEL_ATTRIBUTE_COUNT, header.streams);
+    header.decoding = data.decoding;
+    header.vertexDataSize = data.vertexDataSize;
+    header.vertexOffset = alignBlock(sizeof(CookedMeshHeader));
+    header.indexOffset = alignBlock(header.vertexOffset + data.vertexDataSize);
+    header.submeshOffset = alignBlock(header.indexOffset + data.indexCount * IndexSize(data.indexType));
+    header.lodOffset = alignBlock(header.submeshOffset + data.submeshes.size() * sizeof(Submesh));
+    header.lodErrorOffset = alignBlock(header.lodOffset + data.lods.size() * sizeof(MeshLod));
+    header.materialOffset = alignBlock(header.lodErrorOffset + data.lodErrors.size() * sizeof(float));
+    header.nodeOffset = alignBlock(header.materialOffset + materials.size() * sizeof(CookedMeshMaterial));
+    header.stringOffset = alignBlock(header.nodeOffset + nodes.size() * sizeof(CookedMeshNode));
+    header.stringSize = strings.size();
+
+    // Assembled in memory, then written in one go
+    uint64_t fileSize = header.stringOffset + header.stringSize;
+    std::vector<unsigned char> file(fileSize, 0);
+    memcpy(file.data(), &header, sizeof(header));
+    memcpy(file.data() + header.vertexOffset, data.vertexData, data.vertexDataSize);
+    memcpy(file.data() + header.indexOffset, data.indexData, data.indexCount * IndexSize(data.indexType));
+    memcpy(file.data() + header.submeshOffset, data.submeshes.data(), data.submeshes.size() * sizeof(Submesh));
+    memcpy(file.data() + header.lodOffset, data.lods.data(), data.lods.size() * sizeof(MeshLod));
+    memcpy(file.data() + header.lodErrorOffset, data.lodErrors.data(), data.lodErrors.size() * sizeof(float));
+    memcpy(file.data() + header.materialOffset, materials.data(), materials.size() * sizeof(CookedMeshMaterial));
+    memcpy(file.data() + header.nodeOffset, nodes.data(), nodes.size() * sizeof(CookedMeshNode));
+    memcpy(file.data() + header.stringOffset, strings.data(), strings.size());
+    return DerivedDataCache::store(key, file.data(), file.size());
+}
+
+bool ReadCookedMesh(const DerivedDataKey& key, ModelData& data) {
+    std::shared_ptr<MappedFile> file = DerivedDataCache::find(key);
+    if (!file || file->size() < sizeof(CookedMeshHeader)) {
+        return false;
+    }
+
+    CookedMeshHeader header;
+    memcpy(&header, file->data(), sizeof(header));
+    if (header.magic != COOKED_MESH_MAGIC || header.version != COOKED_MESH_VERSION
+        || (header.indexType != GL_UNSIGNED_SHORT && header.indexType != GL_UNSIGNED_INT)) {
+        return false;
+    }
+
+    // Every block and stream must lie inside the file
+    uint64_t size = file->size();
+    for (const VertexStream& stream : header.streams) {
+        if (stream.size != 0 && stream.offset + uint64_t(header.vertexCount) * stream.stride > header.vertexDataSize) {
+            return false;
+        }
+    }
+    if (header.vertexOffset + header.vertexDataSize > size
+        || header.indexOffset + uint64_t(header.indexCount) * IndexSize(header.indexType) > size
+        || header.submeshOffset + uint64_t(header.submeshCount) * sizeof(Submesh) > size
+        || header.lodOffset + uint64_t(header.meshLodCount) * sizeof(MeshLod) > size
+        || header.lodErrorOffset + uint64_t(header.lodCount) * sizeof(float) > size
+        || header.materialOffset + uint64_t(header.materialCount) * sizeof(CookedMeshMaterial) > size
+        || header.nodeOffset + uint64_t(header.nodeCount) * sizeof(CookedMeshNode) > size
+        || header.stringOffset + header.stringSize > size) {
+        return false;
+    }
+
+    // As must every submesh's indices, vertices, material, node and levels of detail
+    const unsigned char* bytes = file->data();
+    const MeshLod* lods = reinterpret_cast<const MeshLod*>(bytes + header.lodOffset);
+    for (uint32_t i = 0; i < header.meshLodCount; i++) {
+        if (uint64_t(lods[i].firstIndex) + lods[i].indexCount > header.indexCount) {
+            return false;
+        }
+    }
+    const Submesh* submeshes = reinterpret_cast<const Submesh*>(bytes + header.submeshOffset);
+    for (uint32_t i = 0; i < header.submeshCount; i++) {
+        const Submesh& submesh = submeshes[i];
+        if (uint64_t(submesh.firstIndex) + submesh.indexCount > header.indexCount
+            || uint64_t(submesh.baseVertex) + submesh.vertexCount > header.vertexCount
+            || submesh.material >= int64_t(header.materialCount) || submesh.node >= int64_t(header.nodeCount)
+            || (header.lodCount > 0 && uint64_t(submesh.lod) + header.lodCount > header.meshLodCount)) {
+            return false;
+        }
+    }
+    const CookedMeshMaterial* materials = reinterpret_cast<const CookedMeshMaterial*>(bytes + header.materialOffset);
+    for (uint32_t i = 0; i < header.materialCount; i++) {
+        if (materials[i].texturePathOffset + materials[i].texturePathLength > header.stringSize) {
+            return false;
+        }
+    }
+    const CookedMeshNode* nodes = reinterpret_cast<const CookedMeshNode*>(bytes + header.nodeOffset);
+    for (uint32_t i = 0; i < header.nodeCount; i++) {
+        if (nodes[i].parent < -1 || nodes[i].parent >= int64_t(i)
+            || nodes[i].nameOffset + nodes[i].nameLength > header.stringSize) {
+            return false;
+        }
+    }
+
+    data.vertexData = bytes + header.vertexOffset;
+    data.vertexDataSize = header.vertexDataSize;
+    data.vertexCount = header.vertexCount;
+    std::copy(header.streams, header.streams + MODEL_ATTRIBUTE_COUNT, data.streams);
+    data.decoding = header.decoding;
+    data.indexData = bytes + header.indexOffset;
+    data.indexCount = header.indexCount;
+    data.indexType = header.indexType;
+    data.submeshes.assign(submeshes, submeshes + header.submeshCount);
+    data.lods.assign(lods, lods + header.meshLodCount);
+    const float* lodErrors = reinterpret_cast<const float*>(bytes + header.lodErrorOffset);
+    data.lodErrors.assign(lodErrors, lodErrors + header.lodCount);
+    data.materials.clear();
+    data.materials.resize(header.materialCount);
+    const char* strings = reinterpret_cast<const char*>(bytes + header.stringOffset);
+    for (uint32_t i = 0; i < header.materialCount; i++) {
+        data.materials[i].texturePath.assign(strings + materials[i].texturePathOffset, materials[i].texturePathLength);
+    }
+    data.nodes.clear();
+    for (uint32_t i = 0; i < header.nodeCount; i++) {
+        const CookedMeshNode& node = nodes[i];
+        data.nodes.add(node.parent, std::string(strings + node.nameOffset, node.nameLength),
+                       glm::vec3(node.translation[0], node.translation[1], node.translation[2]),
+                       glm::quat(node.rotation[0], node.rotation[1], node.rotation[2], node.rotation[3]),
+                       glm::vec3(node.scale[0], node.scale[1], node.scale[2]));
+    }
+    data.nodes.update();
+    data.boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    data.boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    data.cooked = file;
+    return true;
+}
@@ -0,0 +1,85 @@
+#ifndef MESH_COOK_H
+#define MESH_COOK_H
+
+#include <cstdint>
+#include <string>
+#include <asset/derived_data_cache.h>
+#include "model_asset.h"
+
+// Cooked meshes hold the merged buffers of a glTF file in a versioned binary file that is
+// memory-mapped and handed to glBufferData as it is. Layout, native endianness:
+//
+//   CookedMeshHeader
+//   vertex streams             at vertexOffset, vertexDataSize bytes described by streams
+//   indices                    at indexOffset, indexCount of indexType
+//   Submesh[submeshCount]              at submeshOffset
+//   MeshLod[meshLodCount]              at lodOffset, lodCount from each Submesh::lod on
+//   float[lodCount]                    at lodErrorOffset
+//   CookedMeshMaterial[materialCount]  at materialOffset
+//   CookedMeshNode[nodeCount]          at nodeOffset, parents before children
+//   char[]                             at stringOffset, base color image files and node names
+//
+// Every block starts on a 16 byte boundary. Cooked meshes live in the derived data cache,
+// keyed by the glTF, the files it references and its path as given, which is where the
+// stored texture path is relative to.
+const uint32_t COOKED_MESH_MAGIC = 0x534D5046;     // "FPMS"
+const uint32_t COOKED_MESH_VERSION = 9;
+
+struct CookedMeshHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t indexType;
+    uint32_t submeshCount;
+    float boundsMin[3];
+    float boundsMax[3];
+    uint32_t materialCount;
+    uint32_t nodeCount;
+    uint32_t lodCount;              // Levels of detail of every submesh
+    uint32_t meshLodCount;          // Entries of the MeshLod table
+    VertexStream streams[MODEL_ATTRIBUTE_COUNT];    // Offsets relative to vertexOffset
+    VertexDecoding decoding;
+    uint64_t vertexDataSize;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t submeshOffset;
+    uint64_t lodOffset;
+    uint64_t lodErrorOffset;
+    uint64_t materialOffset;
+    uint64_t nodeOffset;
+    uint64_t stringOffset;
+    uint64_t stringSize;
+};
+
+// Base color image file of one material, texturePathLength 0 when it has none
+struct CookedMeshMaterial {
+    uint64_t texturePathOffset;     // Relative to stringOffset
+    uint64_t texturePathLength;
+};
+
+// Rest pose of one node of the hierarchy
+struct CookedMeshNode {
+    int32_t parent;
+    float translation[3];
+    float rotation[4];              // w, x, y, z
+    float scale[3];
+    uint32_t reserved;
+    uint64_t nameOffset;            // Relative to stringOffset
+    uint64_t nameLength;
+};
+
+// Cache key of the cooked mesh of a glTF file with its vertices in format. Invalid when the file
+// or one it references is missing.
+DerivedDataKey CookedMeshKey(const std::string& sourcePath, const VertexFormat& format = VertexFormat());
+
+// Stores data, decoded from its glTF, under key. Meshes with an embedded base color image
+// in any material are skipped, as the image could not be referenced. Returns false when the entry could
+// not be written.
+bool WriteCookedMesh(const DerivedDataKey& key, const ModelData& data);
+
+// Maps the entry for key and points the mesh views of data into it. Returns false when
+// there is none or it is malformed. The textures are not read.
+bool ReadCookedMesh(const DerivedDataKey& key, ModelData& data);
+
+#endif
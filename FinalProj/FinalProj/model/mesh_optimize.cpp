@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+#include "mesh_optimize.h"
+
+// Modelled cache and score parameters from Forsyth's article
+static const int CacheSize = 32;
+static const float CacheDecayPower = 1.5f;
+static const float LastTriangleScore = 0.75f;
+static const float ValenceBoostScale = 2.0f;
+static const float ValenceBoostPower = 0.5f;
+
+static float vertexScore(int cachePosition, int remainingTriangles) {
+    if (remainingTriangles == 0) {
+        return -1.0f;
+    }
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            // The triangle just drawn, a fixed score so it is not simply reused over and over
+            score = LastTriangleScore;
+        } else {
+            float scaler = 1.0f / (CacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scaler, CacheDecayPower);
+        }
+    }
+    // Favour vertices with few triangles left, so they do not end up stranded
+    return score + ValenceBoostScale * std::pow(float(remainingTriangles), -ValenceBoostPower);
+}
+
+void OptimizeVertexCache(GLuint* indices, size_t indexCount, size_t vertexCount) {
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2) {
+        return;
+    }
+
+    // Triangles of every vertex, as offsets into one array
+    std::vector<int> remaining(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+        remaining[indices[i]]++;
+    }
+    std::vector<size_t> firstTriangle(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+    }
+    std::vector<size_t> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+    std::vector<GLuint> vertexTriangles(triangleCount * 3);
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (int k = 0; k < 3; k++) {
+            vertexTriangles[fill[indices[t * 3 + k]]++] = static_cast<GLuint>(t);
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> score(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        score[v] = vertexScore(-1, remaining[v]);
+    }
+    std::vector<float> triangleScore(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++) {
+        triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<GLuint> output;
+    output.reserve(triangleCount * 3);
+    std::vector<GLuint> cache, nextCache;
+    size_t scan = 0;
+    size_t best = 0;
+    for (size_t t = 1; t < triangleCount; t++) {
+        if (triangleScore[t] > triangleScore[best]) {
+            best = t;
+        }
+    }
+
+    while (output.size() < triangleCount * 3) {
+        emitted[best] = true;
+        const GLuint* triangle = indices + best * 3;
+        output.insert(output.end(), triangle, triangle + 3);
+
+        // The new triangle's vertices move to the front of the modelled LRU cache
+        nextCache.assign(triangle, triangle + 3);
+        for (GLuint v : cache) {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                nextCache.push_back(v);
+            }
+        }
+        for (int k = 0; k < 3; k++) {
+            GLuint v = triangle[k];
+            remaining[v]--;
+            GLuint* begin = vertexTriangles.data() + firstTriangle[v];
+            GLuint* end = begin + remaining[v] + 1;
+            std::remove(begin, end, static_cast<GLuint>(best));
+        }
+
+        // Rescore what was in the cache, vertices pushed out included, and their triangles
+        for (size_t i = 0; i < nextCache.size(); i++) {
+            GLuint v = nextCache[i];
+            cachePosition[v] = i < size_t(CacheSize) ? static_cast<int>(i) : -1;
+            float newScore = vertexScore(cachePosition[v], remaining[v]);
+            float delta = newScore - score[v];
+            score[v] = newScore;
+            for (int j = 0; j < remaining[v]; j++) {
+                triangleScore[vertexTriangles[firstTriangle[v] + j]] += delta;
+            }
+        }
+        if (nextCache.size() > size_t(CacheSize)) {
+            nextCache.resize(CacheSize);
+        }
+        cache.swap(nextCache);
+
+        // Next is the best triangle around the cache, or the first left when the cache has none
+        float bestScore = -1.0f;
+        for (GLuint v : cache) {
+            for (int j = 0; j < remaining[v]; j++) {
+                GLuint t = vertexTriangles[firstTriangle[v] + j];
+                if (triangleScore[t] > bestScore) {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        }
+        if (bestScore < 0.0f) {
+            while (scan < triangleCount && emitted[scan]) {
+                scan++;
+            }
+            if (scan == triangleCount) {
+                break;
+            }
+            best = scan;
+        }
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void OptimizeOverdraw(GLuint* indices, size_t indexCount, const float* positions, size_t vertexCount) {
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2) {
+        return;
+    }
+
+    // Runs start where a 16 entry FIFO, the small end of real post-transform caches, misses
+    // all three vertices
+    const size_t FifoSize = 16;
+    std::vector<size_t> cacheTime(vertexCount, 0);
+    size_t time = FifoSize + 1;
+    std::vector<size_t> runStart;
+    for (size_t t = 0; t < triangleCount; t++) {
+        int misses = 0;
+        for (int k = 0; k < 3; k++) {
+            GLuint v = indices[t * 3 + k];
+            if (time - cacheTime[v] > FifoSize) {
+                cacheTime[v] = time++;
+                misses++;
+            }
+        }
+        if (t == 0 || misses == 3) {
+            runStart.push_back(t);
+        }
+    }
+    runStart.push_back(triangleCount);
+    size_t runCount = runStart.size() - 1;
+    if (runCount < 2) {
+        return;
+    }
+
+    auto position = [&](GLuint v) {
+        return glm::vec3(positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2]);
+    };
+
+    // Area weighted centres and normals of the runs and the mesh
+    std::vector<glm::vec3> runCentre(runCount, glm::vec3(0.0f)), runNormal(runCount, glm::vec3(0.0f));
+    glm::vec3 meshCentre(0.0f);
+    float meshArea = 0.0f;
+    for (size_t r = 0; r < runCount; r++) {
+        float runArea = 0.0f;
+        for (size_t t = runStart[r]; t < runStart[r + 1]; t++) {
+            glm::vec3 a = position(indices[t * 3]), b = position(indices[t * 3 + 1]), c = position(indices[t * 3 + 2]);
+            glm::vec3 normal = glm::cross(b - a, c - a);
+            float area = glm::length(normal);
+            runCentre[r] += (a + b + c) * (area / 3.0f);
+            runNormal[r] += normal;
+            runArea += area;
+        }
+        meshCentre += runCentre[r];
+        meshArea += runArea;
+        runCentre[r] = runArea > 0.0f ? runCentre[r] / runArea : position(indices[runStart[r] * 3]);
+    }
+    if (meshArea > 0.0f) {
+        meshCentre /= meshArea;
+    }
+
+    std::vector<float> key(runCount);
+    std::vector<size_t> order(runCount);
+    for (size_t r = 0; r < runCount; r++) {
+        float length = glm::length(runNormal[r]);
+        key[r] = length > 0.0f ? glm::dot(runCentre[r] - meshCentre, runNormal[r] / length) : 0.0f;
+        order[r] = r;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return key[a] > key[b]; });
+
+    std::vector<GLuint> output;
+    output.reserve(triangleCount * 3);
+    for (size_t r : order) {
+        output.insert(output.end(), indices + runStart[r] * 3, indices + runStart[r + 1] * 3);
+    }
+    std::copy(output.begin(), output.end(), indices);
+}
+
+std::vector<GLuint> OptimizeVertexFetch(GLuint* indices, size_t indexCount, size_t vertexCount) {
+    const GLuint Unused = ~GLuint(0);
+    std::vector<GLuint> remap(vertexCount, Unused);
+    GLuint next = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        GLuint& target = remap[indices[i]];
+        if (target == Unused) {
+            target = next++;
+        }
+        indices[i] = target;
+    }
+    for (GLuint& target : remap) {
+        if (target == Unused) {
+            target = next++;
+        }
+    }
+    return remap;
+}
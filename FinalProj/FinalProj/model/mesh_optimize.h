@@ -0,0 +1,25 @@
+#ifndef MESH_OPTIMIZE_H
+#define MESH_OPTIMIZE_H
+
+#include <cstddef>
+#include <vector>
+#include "glad/gl.h"
+
+// Passes over one triangle list whose indices number vertexCount vertices from 0. They run at
+// cook time, in this order, so the cooked mesh is drawn with fewer vertex shader invocations,
+// less overdraw and fewer cache misses on vertex fetch.
+
+// Reorders the triangles so that consecutive ones reuse recently transformed vertices, with
+// Forsyth's linear-speed vertex cache optimisation.
+void OptimizeVertexCache(GLuint* indices, size_t indexCount, size_t vertexCount);
+
+// Optional, after OptimizeVertexCache. Splits the triangles into the runs that start with a
+// triangle bringing three new vertices, where the cache is cold anyway, and draws the runs
+// facing away from the mesh centre first, as they tend to occlude the others.
+void OptimizeOverdraw(GLuint* indices, size_t indexCount, const float* positions, size_t vertexCount);
+
+// Renumbers the vertices in the order the indices first use them and rewrites the indices.
+// Returns the new number of every old vertex; unused vertices go last.
+std::vector<GLuint> OptimizeVertexFetch(GLuint* indices, size_t indexCount, size_t vertexCount);
+
+#endif
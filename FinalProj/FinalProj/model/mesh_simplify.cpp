@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_set>
+#include <glm/glm.hpp>
+#include "mesh_simplify.h"
+
+// Border planes count this much more than the triangles around them, so outlines go last
+static const double BorderWeight = 10.0;
+
+static uint64_t edgeKey(GLuint from, GLuint to) {
+    return (uint64_t(from) << 32) | to;
+}
+
+static glm::vec3 point(const float* p) {
+    return glm::vec3(p[0], p[1], p[2]);
+}
+
+void MeshSimplifier::Quadric::addPlane(const double normal[3], double distance, double planeWeight) {
+    a[0] += planeWeight * normal[0] * normal[0];
+    a[1] += planeWeight * normal[0] * normal[1];
+    a[2] += planeWeight * normal[0] * normal[2];
+    a[3] += planeWeight * normal[1] * normal[1];
+    a[4] += planeWeight * normal[1] * normal[2];
+    a[5] += planeWeight * normal[2] * normal[2];
+    for (int i = 0; i < 3; i++) {
+        b[i] += planeWeight * distance * normal[i];
+    }
+    c += planeWeight * distance * distance;
+    weight += planeWeight;
+}
+
+void MeshSimplifier::Quadric::add(const Quadric& other) {
+    for (int i = 0; i < 6; i++) {
+        a[i] += other.a[i];
+    }
+    for (int i = 0; i < 3; i++) {
+        b[i] += other.b[i];
+    }
+    c += other.c;
+    weight += other.weight;
+}
+
+double MeshSimplifier::Quadric::evaluate(const float* p) const {
+    double x = p[0], y = p[1], z = p[2];
+    double value = a[0] * x * x + a[3] * y * y + a[5] * z * z
+                 + 2.0 * (a[1] * x * y + a[2] * x * z + a[4] * y * z)
+                 + 2.0 * (b[0] * x + b[1] * y + b[2] * z) + c;
+    // Mean squared distance over the planes, rounding may take it just below 0
+    return weight > 0.0 ? std::max(value / weight, 0.0) : 0.0;
+}
+
+MeshSimplifier::MeshSimplifier(const GLuint* indices, size_t indexCount, const float* positions, size_t vertexCount)
+    : current(indices, indices + indexCount / 3 * 3), positions(positions), vertexCount(vertexCount),
+      quadrics(vertexCount), kinds(vertexCount, VERTEX_MANIFOLD) {
+    // Vertices with the position of another are split by a seam in some other attribute;
+    // moving one copy would tear the surface open
+    std::vector<GLuint> order(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        order[v] = static_cast<GLuint>(v);
+    }
+    auto less = [&](GLuint a, GLuint b) {
+        return std::lexicographical_compare(position(a), position(a) + 3, position(b), position(b) + 3);
+    };
+    std::sort(order.begin(), order.end(), less);
+    for (size_t i = 1; i < order.size(); i++) {
+        if (!less(order[i - 1], order[i])) {
+            kinds[order[i - 1]] = kinds[order[i]] = VERTEX_LOCKED;
+        }
+    }
+
+    // A half-edge without its reverse lies on a border. One border through a vertex leaves
+    // it by one edge and enters by another; anything else is a corner where borders meet.
+    std::unordered_set<uint64_t> edges;
+    for (size_t i = 0; i < current.size(); i += 3) {
+        for (int k = 0; k < 3; k++) {
+            edges.insert(edgeKey(current[i + k], current[i + (k + 1) % 3]));
+        }
+    }
+    std::vector<int> borderOut(vertexCount, 0), borderIn(vertexCount, 0);
+    for (size_t i = 0; i < current.size(); i += 3) {
+        const float* p[3] = { position(current[i]), position(current[i + 1]), position(current[i + 2]) };
+        glm::dvec3 a(p[0][0], p[0][1], p[0][2]), b(p[1][0], p[1][1], p[1][2]), c(p[2][0], p[2][1], p[2][2]);
+        glm::dvec3 normal = glm::cross(b - a, c - a);
+        double length = glm::length(normal);
+        if (length == 0.0) {
+            continue;
+        }
+        normal /= length;
+
+        double plane[3] = { normal.x, normal.y, normal.z };
+        for (int k = 0; k < 3; k++) {
+            quadrics[current[i + k]].addPlane(plane, -glm::dot(normal, a), length * 0.5);
+        }
+
+        glm::dvec3 corners[3] = { a, b, c };
+        for (int k = 0; k < 3; k++) {
+            GLuint from = current[i + k], to = current[i + (k + 1) % 3];
+            if (edges.count(edgeKey(to, from))) {
+                continue;
+            }
+            borderOut[from]++;
+            borderIn[to]++;
+
+            // Plane through the edge, upright on the triangle
+            glm::dvec3 edge = corners[(k + 1) % 3] - corners[k];
+            glm::dvec3 side = glm::cross(edge, normal);
+            double sideLength = glm::length(side);
+            if (sideLength == 0.0) {
+                continue;
+            }
+            side /= sideLength;
+            double sidePlane[3] = { side.x, side.y, side.z };
+            double edgeWeight = glm::dot(edge, edge) * BorderWeight;
+            quadrics[from].addPlane(sidePlane, -glm::dot(side, corners[k]), edgeWeight);
+            quadrics[to].addPlane(sidePlane, -glm::dot(side, corners[k]), edgeWeight);
+        }
+    }
+    for (size_t v = 0; v < vertexCount; v++) {
+        if (kinds[v] == VERTEX_LOCKED || (borderOut[v] == 0 && borderIn[v] == 0)) {
+            continue;
+        }
+        kinds[v] = borderOut[v] == 1 && borderIn[v] == 1 ? VERTEX_BORDER : VERTEX_LOCKED;
+    }
+}
+
+void MeshSimplifier::buildAdjacency() {
+    firstTriangle.assign(vertexCount + 1, 0);
+    for (GLuint v : current) {
+        firstTriangle[v + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++) {
+        firstTriangle[v + 1] += firstTriangle[v];
+    }
+    std::vector<size_t> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+    vertexTriangles.resize(current.size());
+    for (size_t i = 0; i < current.size(); i++) {
+        vertexTriangles[fill[current[i]]++] = static_cast<GLuint>(i / 3);
+    }
+}
+
+bool MeshSimplifier::flips(GLuint from, GLuint to) const {
+    for (size_t j = firstTriangle[from]; j < firstTriangle[from + 1]; j++) {
+        const GLuint* triangle = current.data() + size_t(vertexTriangles[j]) * 3;
+        if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+            continue;   // Collapses with the edge
+        }
+
+        // The other two corners in winding order, so the normals compare with their signs
+        int k = triangle[0] == from ? 0 : triangle[1] == from ? 1 : 2;
+        glm::vec3 b = point(position(triangle[(k + 1) % 3])), c = point(position(triangle[(k + 2) % 3]));
+        glm::vec3 before = glm::cross(b - point(position(from)), c - point(position(from)));
+        glm::vec3 after = glm::cross(b - point(position(to)), c - point(position(to)));
+        if (glm::dot(before, after) <= 0.0f) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MeshSimplifier::simplify(size_t targetIndexCount) {
+    struct Collapse {
+        GLuint from, to;
+        double error;
+    };
+
+    bool collapsed = false;
+    std::vector<Collapse> collapses;
+    std::vector<unsigned char> touched;
+    std::vector<GLuint> remap;
+    std::unordered_set<uint64_t> edges;
+    while (current.size() > targetIndexCount) {
+        buildAdjacency();
+        edges.clear();
+        for (size_t i = 0; i < current.size(); i += 3) {
+            for (int k = 0; k < 3; k++) {
+                edges.insert(edgeKey(current[i + k], current[i + (k + 1) % 3]));
+            }
+        }
+
+        // Both directions of every edge that may collapse, cheapest first
+        collapses.clear();
+        for (size_t i = 0; i < current.size(); i += 3) {
+            for (int k = 0; k < 3; k++) {
+                GLuint a = current[i + k], b = current[i + (k + 1) % 3];
+                bool border = !edges.count(edgeKey(b, a));
+                for (int direction = 0; direction < 2; direction++) {
+                    GLuint from = direction ? b : a, to = direction ? a : b;
+                    if (kinds[from] == VERTEX_LOCKED || (kinds[from] == VERTEX_BORDER && !border)) {
+                        continue;
+                    }
+                    Quadric merged = quadrics[from];
+                    merged.add(quadrics[to]);
+                    collapses.push_back({ from, to, merged.evaluate(position(to)) });
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) {
+            return x.error < y.error;
+        });
+
+        // Collapses whose neighbourhoods do not overlap, so each sees the triangles the flip
+        // test saw, until enough triangles are gone
+        size_t excess = (current.size() - targetIndexCount + 2) / 3;
+        size_t removed = 0;
+        touched.assign(vertexCount, 0);
+        remap.resize(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++) {
+            remap[v] = static_cast<GLuint>(v);
+        }
+        bool progress = false;
+        for (const Collapse& collapse : collapses) {
+            if (removed >= excess) {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to] || flips(collapse.from, collapse.to)) {
+                continue;
+            }
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            maxError = std::max(maxError, collapse.error);
+            progress = true;
+            for (size_t j = firstTriangle[collapse.from]; j < firstTriangle[collapse.from + 1]; j++) {
+                const GLuint* triangle = current.data() + size_t(vertexTriangles[j]) * 3;
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+                    removed++;
+                }
+                touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+            }
+        }
+        if (!progress) {
+            break;
+        }
+        collapsed = true;
+
+        // Triangles that lost an edge are gone
+        size_t kept = 0;
+        for (size_t i = 0; i < current.size(); i += 3) {
+            GLuint a = remap[current[i]], b = remap[current[i + 1]], c = remap[current[i + 2]];
+            if (a != b && b != c && a != c) {
+                current[kept++] = a;
+                current[kept++] = b;
+                current[kept++] = c;
+            }
+        }
+        current.resize(kept);
+    }
+    return collapsed;
+}
+
+float MeshSimplifier::error() const {
+    return static_cast<float>(std::sqrt(maxError));
+}
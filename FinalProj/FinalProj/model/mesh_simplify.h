@@ -0,0 +1,65 @@
+#ifndef MESH_SIMPLIFY_H
+#define MESH_SIMPLIFY_H
+
+#include <cstddef>
+#include <vector>
+#include "glad/gl.h"
+
+// Quadric error edge collapse over one triangle list whose indices number vertexCount vertices
+// from 0, after Garland and Heckbert. Vertices are only ever collapsed onto a neighbour, never
+// moved or created, so every level of detail indexes the vertices of the full mesh.
+//
+// Each vertex accumulates the squared distances to the planes of its triangles, weighted by
+// area, and to planes standing on its border edges, so open borders such as leaf cards keep
+// their outline. Vertices sharing a position with another vertex sit on an attribute seam and
+// never move, nor do vertices where borders meet. Passes collapse the cheapest edges whose
+// neighbourhoods do not overlap, rejecting collapses that flip a triangle, until the target
+// is reached or nothing is left to collapse.
+//
+// simplify() continues from where the previous call stopped, so calling it with decreasing
+// targets builds a chain of levels whose error is measured against the original mesh.
+class MeshSimplifier {
+public:
+    MeshSimplifier(const GLuint* indices, size_t indexCount, const float* positions, size_t vertexCount);
+
+    // Collapses until at most targetIndexCount indices remain. Returns false when no collapse was possible.
+    bool simplify(size_t targetIndexCount);
+
+    const std::vector<GLuint>& indices() const { return current; }
+
+    // Largest distance, in position units, between the original surface and what the collapses so far made of it
+    float error() const;
+
+private:
+    struct Quadric {
+        double a[6] = {};       // Symmetric 3x3, xx xy xz yy yz zz
+        double b[3] = {};
+        double c = 0.0;
+        double weight = 0.0;
+
+        void addPlane(const double normal[3], double distance, double planeWeight);
+        void add(const Quadric& other);
+        double evaluate(const float* p) const;
+    };
+
+    enum VertexKind : unsigned char {
+        VERTEX_MANIFOLD,        // Collapses onto any neighbour
+        VERTEX_BORDER,          // On one open border, collapses along it
+        VERTEX_LOCKED           // Never collapses
+    };
+
+    const float* position(GLuint v) const { return positions + size_t(v) * 3; }
+    void buildAdjacency();
+    bool flips(GLuint from, GLuint to) const;
+
+    std::vector<GLuint> current;
+    std::vector<size_t> firstTriangle;      // Triangles of vertex v are vertexTriangles[firstTriangle[v], firstTriangle[v + 1])
+    std::vector<GLuint> vertexTriangles;
+    const float* positions;
+    size_t vertexCount;
+    std::vector<Quadric> quadrics;
+    std::vector<unsigned char> kinds;
+    double maxError = 0.0;
+};
+
+#endif
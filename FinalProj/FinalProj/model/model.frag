@@ -3,37 +3,53 @@
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
+in float Fade;
+
+layout(std140) uniform FrameConstants {
+    mat4 viewProjection;
+    mat4 lightSpaceMatrix;
+    vec4 lightPosition;
+    vec4 lightIntensity;
+    vec4 viewPosition;
+};
 
-uniform vec3 lightPos;
-uniform vec3 viewPos;
-uniform vec3 lightColor;
 uniform vec3 objectColor;
 uniform sampler2D modelTexture;
 uniform bool hasTexture;
 
 out vec4 FragColor;
 
+// Screen-space noise in [0, 1), the impostor shader drops the complement of what this keeps
+float ditherNoise() {
+    return fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+}
+
 void main() {
+    // Cross-fade with the impostor
+    if (Fade > 0.0 && ditherNoise() < Fade) {
+        discard;
+    }
+
     // Normalize input normal
     vec3 normal = normalize(Normal);
 
     // Calculate lighting vectors
-    vec3 lightDir = normalize(lightPos - FragPos);
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 lightDir = normalize(lightPosition.xyz - FragPos);
+    vec3 viewDir = normalize(viewPosition.xyz - FragPos);
     vec3 reflectDir = reflect(-lightDir, normal);
 
     // Ambient lighting
     float ambientStrength = 0.2;
-    vec3 ambient = ambientStrength * lightColor;
+    vec3 ambient = ambientStrength * lightIntensity.rgb;
 
     // Diffuse lighting
     float diff = max(dot(normal, lightDir), 0.0);
-    vec3 diffuse = diff * lightColor;
+    vec3 diffuse = diff * lightIntensity.rgb;
 
     // Specular lighting
     float specularStrength = 0.5;
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
-    vec3 specular = specularStrength * spec * lightColor;
+    vec3 specular = specularStrength * spec * lightIntensity.rgb;
 
     // Get base color
     vec3 baseColor;
@@ -1,40 +1,69 @@
 #ifndef MODEL_H
 #define MODEL_H
 
+#include <memory>
 #include <string>
-#include <vector>
 #include <glm/glm.hpp>
 #include "glad/gl.h"
-#include "tiny_gltf.h"
+#include "model_asset.h"
+#include <render/frame_constants.h>
+#include <render/frustum_culler.h>
+#include <render/shader.h>
 
-struct Vertex {
-    glm::vec3 position;
-    glm::vec3 normal;
-    glm::vec2 texCoords;
+// Level of asset to draw under transform, the coarsest whose error projects to at most
+// LodErrorPixels from the camera, measured at the near side of the asset's bounds. Coarsening
+// from current needs the error under a fraction of that, so levels do not flicker back and
+// forth at the threshold; refining happens straight away.
+int SelectLod(const ModelAsset& asset, const glm::mat4& transform, const LodView& view, int current);
+
+// Uniform locations of the model shaders, looked up once after linking
+// Camera and lighting come from the FrameConstants uniform buffer.
+struct ModelUniforms {
+    GLint model, objectColor, modelTexture, hasTexture;
+    GLint positionOffset, positionScale, texcoordOffset, texcoordScale, octahedralNormals;
+
+    void locate(const ShaderProgram& program);
+
+    // Sets material and texture state on the bound program; the model matrix is left to the caller
+    void setMaterial(GLuint textureID) const;
+
+    // Sets how the shader undoes the vertex quantisation of an asset
+    void setDecoding(const VertexDecoding& decoding) const;
+
+    // Draws every submesh of asset with its VAO bound, setting each material once as the
+    // submeshes come sorted by it. The model matrix of a submesh is transform times the world
+    // matrix of its node in nodes. More than one instance draws instanced. Each submesh draws
+    // its indices of level lod.
+    void drawSubmeshes(const ModelAsset& asset, const NodeHierarchy& nodes, const glm::mat4& transform,
+                       GLsizei instanceCount = 1, int lod = 0) const;
 };
 
 class Model {
 public:
-    GLuint programID;
+    ShaderProgram program;
+    NodeHierarchy nodes;    // This model's pose of the asset's node tree, starts at the rest pose
 
 private:
-    GLuint textureID;
-    GLuint VAO, VBO, EBO;
-    std::vector<Vertex> vertices;
-    std::vector<GLuint> indices;
+    ModelUniforms uniforms;
+    std::shared_ptr<ModelAsset> asset;
     glm::mat4 modelMatrix;
-    tinygltf::Model model;
-    tinygltf::TinyGLTF loader;
-    bool loadTexture(const tinygltf::Model& model, int textureIndex);
+    int lod = 0;            // Level drawn last frame
+    FrustumCuller* culler = nullptr;
+    CullRange cullBox;
+    bool boundsDirty = true;
 
 public:
     Model();
-    ~Model();
 
     bool loadModel(const std::string& path);
-    void processMesh(const tinygltf::Model& model, const tinygltf::Mesh& mesh);
-    void setupMesh();
-    void render(glm::mat4 viewProjectionMatrix, glm::vec3 eye_center);
+    void render(const LodView& view);
+
+    // Gives the model a box in culler, render() then skips it when the camera pass does not see it
+    void attachCulling(FrustumCuller& culler);
+    // Moves the box to the current model matrix, before the passes are culled
+    void updateBounds();
+    const CullRange& box() const { return cullBox; }
+
     void setPosition(const glm::vec3& position);
     void setRotation(float angle, const glm::vec3& axis);
     void setScale(const glm::vec3& scale);
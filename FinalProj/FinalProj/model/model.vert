@@ -4,23 +4,52 @@ layout (location = 0) in vec3 inPosition;
 layout (location = 1) in vec3 inNormal;
 layout (location = 2) in vec2 inTexCoords;
 
+layout(std140) uniform FrameConstants {
+    mat4 viewProjection;
+    mat4 lightSpaceMatrix;
+    vec4 lightPosition;
+    vec4 lightIntensity;
+    vec4 viewPosition;
+};
+
 uniform mat4 model;
-uniform mat4 vp;
+
+// Undoes the vertex quantisation, see VertexDecoding
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+uniform vec2 texcoordOffset;
+uniform vec2 texcoordScale;
+uniform bool octahedralNormals;
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
+out float Fade;
+
+vec3 decodeNormal(vec3 stored) {
+    if (!octahedralNormals) {
+        return stored;
+    }
+    vec3 n = vec3(stored.xy, 1.0 - abs(stored.x) - abs(stored.y));
+    float fold = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -fold : fold;
+    n.y += n.y >= 0.0 ? -fold : fold;
+    return normalize(n);
+}
 
 void main() {
+    vec3 position = positionOffset + positionScale * inPosition;
+
     // Calculate the position in clip space
-    gl_Position = vp * model * vec4(inPosition, 1.0);
+    gl_Position = viewProjection * model * vec4(position, 1.0);
 
     // Calculate fragment position in world space
-    FragPos = vec3(model * vec4(inPosition, 1.0));
+    FragPos = vec3(model * vec4(position, 1.0));
 
     // Transform normal vector to world space
-    Normal = mat3(transpose(inverse(model))) * inNormal;
+    Normal = mat3(transpose(inverse(model))) * decodeNormal(inNormal);
 
     // Pass to frag shader
-    TexCoords = inTexCoords;
+    TexCoords = texcoordOffset + texcoordScale * inTexCoords;
+    Fade = 0.0;
 }
\ No newline at end of file
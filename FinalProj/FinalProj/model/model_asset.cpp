@@ -0,0 +1,918 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "glad/gl.h"
+#include "model.h"
+#include "model_asset.h"
+#include "mesh_cook.h"
+#include "mesh_optimize.h"
+#include "mesh_simplify.h"
+#include <asset/virtual_file_system.h>
+#define TINYGLTF_IMPLEMENTATION
+#define TINYGLTF_NO_EXTERNAL_IMAGE
+#include "tiny_gltf.h"
+
+// External images are never read by tinygltf (TINYGLTF_NO_EXTERNAL_IMAGE). Embedded ones are kept
+// encoded, only the base color image gets decoded once the material is known.
+static bool keepImageData(tinygltf::Image* image, const int, std::string*, std::string*,
+                          int, int, const unsigned char* bytes, int size, void*) {
+    image->image.assign(bytes, bytes + size);
+    return true;
+}
+
+// glTF files and their buffers are read through the VirtualFileSystem, so they can come from a pack
+static bool virtualFileExists(const std::string& path, void*) {
+    return VirtualFileSystem::exists(path);
+}
+
+static bool readVirtualFile(std::vector<unsigned char>* out, std::string* err, const std::string& path, void*) {
+    VirtualFile file = VirtualFileSystem::open(path);
+    if (!file.valid()) {
+        if (err) {
+            *err += "File open error : " + path + "\n";
+        }
+        return false;
+    }
+    out->assign(file.data(), file.data() + file.size());
+    return true;
+}
+
+static bool virtualFileSize(size_t* size, std::string* err, const std::string& path, void*) {
+    uint64_t fileSize;
+    int64_t time;
+    if (!VirtualFileSystem::stat(path, fileSize, time)) {
+        if (err) {
+            *err += "File open error : " + path + "\n";
+        }
+        return false;
+    }
+    *size = static_cast<size_t>(fileSize);
+    return true;
+}
+
+static std::string directoryOf(const std::string& path) {
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+static void decodeTexture(MaterialData& material, const ModelData& data, const tinygltf::Model& model, int textureIndex) {
+    const tinygltf::Texture& texture = model.textures[textureIndex];
+    const tinygltf::Image& image = model.images[texture.source];
+
+    if (!image.uri.empty()) {
+        material.texturePath = directoryOf(data.path) + image.uri;
+        material.texture = ReadTextureImage(material.texturePath);
+    } else {
+        material.texturePath.clear();
+        material.texture = DecodeImageRGBA(image.image.data(), image.image.size());
+    }
+    if (!material.texture.valid()) {
+        std::cout << "Failed to decode base color texture of " << data.path << std::endl;
+    }
+}
+
+// Levels of detail per primitive, the full mesh included, down to 1/32 of its triangles
+static const size_t MaxLodCount = 6;
+// A level keeping more than this share of the triangles of the one before is not worth drawing
+static const float LodMinReduction = 0.9f;
+
+// glTF semantic of each ModelAttribute
+static const char* const attributeSemantics[MODEL_ATTRIBUTE_COUNT] = { "POSITION", "NORMAL", "TEXCOORD_0" };
+
+static const tinygltf::Accessor* findAccessor(const tinygltf::Model& model, const tinygltf::Primitive& primitive,
+                                              const char* semantic) {
+    auto it = primitive.attributes.find(semantic);
+    return it != primitive.attributes.end() ? &model.accessors[it->second] : nullptr;
+}
+
+static size_t elementSize(const tinygltf::Accessor& accessor) {
+    return static_cast<size_t>(tinygltf::GetComponentSizeInBytes(accessor.componentType))
+        * tinygltf::GetNumComponentsInType(accessor.type);
+}
+
+// First element of an accessor inside its buffer, honouring the accessor and view offsets.
+// Returns nullptr when there is no buffer view or the elements do not fit in the buffer.
+static const unsigned char* accessorData(const tinygltf::Model& model, const tinygltf::Accessor& accessor, size_t& stride) {
+    if (accessor.bufferView < 0) {
+        return nullptr;
+    }
+    const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
+    const tinygltf::Buffer& buffer = model.buffers[view.buffer];
+    int byteStride = accessor.ByteStride(view);
+    if (byteStride <= 0) {
+        return nullptr;
+    }
+    size_t start = view.byteOffset + accessor.byteOffset;
+    if (accessor.count > 0 && start + (accessor.count - 1) * byteStride + elementSize(accessor) > buffer.data.size()) {
+        return nullptr;
+    }
+    stride = static_cast<size_t>(byteStride);
+    return buffer.data.data() + start;
+}
+
+// One component as a float, with the glTF rules for normalized integers
+static float readComponent(const unsigned char* bytes, int componentType, bool normalized) {
+    switch (componentType) {
+        case TINYGLTF_COMPONENT_TYPE_BYTE: {
+            int8_t value;
+            memcpy(&value, bytes, sizeof(value));
+            return normalized ? std::max(value / 127.0f, -1.0f) : value;
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+            return normalized ? bytes[0] / 255.0f : bytes[0];
+        case TINYGLTF_COMPONENT_TYPE_SHORT: {
+            int16_t value;
+            memcpy(&value, bytes, sizeof(value));
+            return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+            uint16_t value;
+            memcpy(&value, bytes, sizeof(value));
+            return normalized ? value / 65535.0f : value;
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: {
+            uint32_t value;
+            memcpy(&value, bytes, sizeof(value));
+            return static_cast<float>(value);
+        }
+        case TINYGLTF_COMPONENT_TYPE_FLOAT: {
+            float value;
+            memcpy(&value, bytes, sizeof(value));
+            return value;
+        }
+    }
+    return 0.0f;
+}
+
+static VertexStream streamFormat(const tinygltf::Model& model, const tinygltf::Accessor& accessor) {
+    VertexStream format;
+    format.size = tinygltf::GetNumComponentsInType(accessor.type);
+    format.type = accessor.componentType;
+    format.normalized = accessor.normalized ? GL_TRUE : GL_FALSE;
+    format.stride = accessor.bufferView >= 0 ? accessor.ByteStride(model.bufferViews[accessor.bufferView]) : 0;
+    return format;
+}
+
+// Builds the stream of one attribute over all primitives. When every primitive stores it in the
+// same format, their accessor bytes are copied as they are, interleaved neighbours and all, and
+// the stream keeps the glTF stride, type and normalization. Mixed formats are converted to floats.
+static void buildStream(ModelData& data, const tinygltf::Model& model, const std::vector<const tinygltf::Primitive*>& primitives,
+                        const std::vector<Submesh>& ranges, int attribute) {
+    VertexStream format;
+    bool present = false, asIs = true;
+    for (size_t i = 0; i < primitives.size(); i++) {
+        const tinygltf::Accessor* accessor = findAccessor(model, *primitives[i], attributeSemantics[attribute]);
+        if (!accessor) {
+            continue;
+        }
+        size_t stride;
+        VertexStream candidate = streamFormat(model, *accessor);
+        if (!accessorData(model, *accessor, stride) || accessor->count < ranges[i].vertexCount) {
+            asIs = false;
+        }
+        if (!present) {
+            format = candidate;
+            present = true;
+        } else if (candidate.size != format.size || candidate.type != format.type
+                   || candidate.normalized != format.normalized || candidate.stride != format.stride) {
+            asIs = false;
+        }
+    }
+
+    data.streams[attribute] = VertexStream();
+    if (!present) {
+        return;
+    }
+    if (!asIs) {
+        format.type = GL_FLOAT;
+        format.normalized = GL_FALSE;
+        format.stride = format.size * sizeof(float);
+    }
+
+    // Streams start on 4 byte boundaries, as GL wants for every attribute type
+    format.offset = (data.vertexBytes.size() + 3) & ~size_t(3);
+    data.vertexBytes.resize(format.offset + data.vertexCount * format.stride, 0);
+    data.streams[attribute] = format;
+
+    // Primitives without the attribute keep zeros
+    for (size_t i = 0; i < primitives.size(); i++) {
+        const tinygltf::Accessor* accessor = findAccessor(model, *primitives[i], attributeSemantics[attribute]);
+        size_t stride;
+        const unsigned char* source = accessor ? accessorData(model, *accessor, stride) : nullptr;
+        const Submesh& range = ranges[i];
+        if (!source || range.vertexCount == 0) {
+            continue;
+        }
+
+        unsigned char* target = data.vertexBytes.data() + format.offset + size_t(range.baseVertex) * format.stride;
+        if (asIs) {
+            memcpy(target, source, (range.vertexCount - 1) * stride + elementSize(*accessor));
+            continue;
+        }
+
+        size_t componentSize = tinygltf::GetComponentSizeInBytes(accessor->componentType);
+        int components = std::min(format.size, tinygltf::GetNumComponentsInType(accessor->type));
+        for (size_t v = 0; v < range.vertexCount; v++) {
+            for (int c = 0; c < components; c++) {
+                float value = readComponent(source + v * stride + c * componentSize, accessor->componentType, accessor->normalized);
+                memcpy(target + v * format.stride + c * sizeof(float), &value, sizeof(float));
+            }
+        }
+    }
+}
+
+// Nearest half float, flushing what is too small for a normal half to zero
+static uint16_t toHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    int exponent = static_cast<int>((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+    if (((bits >> 23) & 0xFF) == 0xFF) {
+        return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+    }
+    if (exponent <= 0) {
+        return sign;
+    }
+    // Round to nearest, a carry out of the mantissa correctly bumps the exponent
+    uint32_t half = (static_cast<uint32_t>(exponent) << 10) + ((mantissa + 0x1000) >> 13);
+    return half >= 0x7C00 ? sign | 0x7C00 : sign | static_cast<uint16_t>(half);
+}
+
+static int16_t toSnorm16(float value) {
+    return static_cast<int16_t>(std::lround(glm::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+static uint16_t toUnorm16(float value) {
+    return static_cast<uint16_t>(std::lround(glm::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+// Folds the unit sphere onto the square [-1, 1]^2, lower hemisphere over the corners
+static glm::vec2 octahedralEncode(glm::vec3 normal) {
+    float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (length == 0.0f) {
+        return glm::vec2(0.0f);
+    }
+    glm::vec2 p = glm::vec2(normal.x, normal.y) / length;
+    if (normal.z < 0.0f) {
+        p = glm::vec2((1.0f - std::abs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f),
+                      (1.0f - std::abs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f));
+    }
+    return p;
+}
+
+// Every vertex of one attribute as floats, components apart, zeros where a primitive lacks it
+static std::vector<float> readAttribute(const tinygltf::Model& model, const std::vector<const tinygltf::Primitive*>& primitives,
+                                        const std::vector<Submesh>& ranges, size_t vertexCount, int attribute, int components) {
+    std::vector<float> values(vertexCount * components, 0.0f);
+    for (size_t i = 0; i < primitives.size(); i++) {
+        const tinygltf::Accessor* accessor = findAccessor(model, *primitives[i], attributeSemantics[attribute]);
+        size_t stride;
+        const unsigned char* source = accessor ? accessorData(model, *accessor, stride) : nullptr;
+        if (!source) {
+            continue;
+        }
+        size_t componentSize = tinygltf::GetComponentSizeInBytes(accessor->componentType);
+        int count = std::min(components, tinygltf::GetNumComponentsInType(accessor->type));
+        size_t vertices = std::min<size_t>(ranges[i].vertexCount, accessor->count);
+        for (size_t v = 0; v < vertices; v++) {
+            float* target = &values[(ranges[i].baseVertex + v) * components];
+            for (int c = 0; c < count; c++) {
+                target[c] = readComponent(source + v * stride + c * componentSize, accessor->componentType, accessor->normalized);
+            }
+        }
+    }
+    return values;
+}
+
+static bool hasAttribute(const tinygltf::Model& model, const std::vector<const tinygltf::Primitive*>& primitives, int attribute) {
+    for (const tinygltf::Primitive* primitive : primitives) {
+        if (findAccessor(model, *primitive, attributeSemantics[attribute])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Range of every component over the values, scale never zero so it can be divided by
+static void valueRange(const std::vector<float>& values, int components, float* offset, float* scale) {
+    for (int c = 0; c < components; c++) {
+        float lo = FLT_MAX, hi = -FLT_MAX;
+        for (size_t i = c; i < values.size(); i += components) {
+            lo = std::min(lo, values[i]);
+            hi = std::max(hi, values[i]);
+        }
+        offset[c] = lo <= hi ? lo : 0.0f;
+        scale[c] = hi > lo ? hi - lo : 1.0f;
+    }
+}
+
+// Appends a stream of count 16 bit components per vertex, padded to a multiple of 4 bytes
+static VertexStream appendStream16(ModelData& data, int size, GLenum type, bool normalized) {
+    VertexStream stream;
+    stream.size = size;
+    stream.type = type;
+    stream.normalized = normalized ? GL_TRUE : GL_FALSE;
+    stream.stride = static_cast<uint32_t>((size * sizeof(uint16_t) + 3) & ~size_t(3));
+    stream.offset = (data.vertexBytes.size() + 3) & ~size_t(3);
+    data.vertexBytes.resize(stream.offset + data.vertexCount * stream.stride, 0);
+    return stream;
+}
+
+static void store16(ModelData& data, const VertexStream& stream, size_t vertex, int component, uint16_t value) {
+    memcpy(data.vertexBytes.data() + stream.offset + vertex * stream.stride + component * sizeof(uint16_t), &value, sizeof(value));
+}
+
+// Builds the stream of one attribute in a compact format of format, recording in data.decoding
+// how the shader turns it back
+static void encodeStream(ModelData& data, const tinygltf::Model& model, const std::vector<const tinygltf::Primitive*>& primitives,
+                         const std::vector<Submesh>& ranges, int attribute, const VertexFormat& format) {
+    data.streams[attribute] = VertexStream();
+    if (!hasAttribute(model, primitives, attribute)) {
+        return;
+    }
+
+    VertexDecoding& decoding = data.decoding;
+    if (attribute == ATTRIBUTE_POSITION) {
+        std::vector<float> values = readAttribute(model, primitives, ranges, data.vertexCount, attribute, 3);
+        if (format.position == POSITION_HALF) {
+            VertexStream stream = appendStream16(data, 3, GL_HALF_FLOAT, false);
+            for (size_t i = 0; i < values.size(); i++) {
+                store16(data, stream, i / 3, i % 3, toHalf(values[i]));
+            }
+            data.streams[attribute] = stream;
+            return;
+        }
+
+        // Centre and half extent of the box around every position
+        float offset[3], scale[3];
+        valueRange(values, 3, offset, scale);
+        for (int c = 0; c < 3; c++) {
+            decoding.positionScale[c] = scale[c] * 0.5f;
+            decoding.positionOffset[c] = offset[c] + decoding.positionScale[c];
+        }
+        VertexStream stream = appendStream16(data, 3, GL_SHORT, true);
+        for (size_t i = 0; i < values.size(); i++) {
+            int c = i % 3;
+            float normalized = (values[i] - decoding.positionOffset[c]) / decoding.positionScale[c];
+            store16(data, stream, i / 3, c, static_cast<uint16_t>(toSnorm16(normalized)));
+        }
+        data.streams[attribute] = stream;
+    } else if (attribute == ATTRIBUTE_NORMAL) {
+        std::vector<float> values = readAttribute(model, primitives, ranges, data.vertexCount, attribute, 3);
+        VertexStream stream = appendStream16(data, 2, GL_SHORT, true);
+        for (size_t v = 0; v < data.vertexCount; v++) {
+            glm::vec2 p = octahedralEncode(glm::vec3(values[v * 3], values[v * 3 + 1], values[v * 3 + 2]));
+            store16(data, stream, v, 0, static_cast<uint16_t>(toSnorm16(p.x)));
+            store16(data, stream, v, 1, static_cast<uint16_t>(toSnorm16(p.y)));
+        }
+        decoding.octahedralNormals = 1;
+        data.streams[attribute] = stream;
+    } else {
+        std::vector<float> values = readAttribute(model, primitives, ranges, data.vertexCount, attribute, 2);
+        if (format.texcoord == TEXCOORD_HALF) {
+            VertexStream stream = appendStream16(data, 2, GL_HALF_FLOAT, false);
+            for (size_t i = 0; i < values.size(); i++) {
+                store16(data, stream, i / 2, i % 2, toHalf(values[i]));
+            }
+            data.streams[attribute] = stream;
+            return;
+        }
+
+        // Tiling texcoords beyond [0, 1] keep their range through the offset and scale
+        float offset[2], scale[2];
+        valueRange(values, 2, offset, scale);
+        decoding.texcoordOffset = glm::vec2(offset[0], offset[1]);
+        decoding.texcoordScale = glm::vec2(scale[0], scale[1]);
+        VertexStream stream = appendStream16(data, 2, GL_UNSIGNED_SHORT, true);
+        for (size_t i = 0; i < values.size(); i++) {
+            int c = i % 2;
+            store16(data, stream, i / 2, c, toUnorm16((values[i] - offset[c]) / scale[c]));
+        }
+        data.streams[attribute] = stream;
+    }
+}
+
+static size_t componentSize(GLenum type) {
+    switch (type) {
+        case GL_BYTE:
+        case GL_UNSIGNED_BYTE:
+            return 1;
+        case GL_SHORT:
+        case GL_UNSIGNED_SHORT:
+        case GL_HALF_FLOAT:
+            return 2;
+    }
+    return 4;
+}
+
+// Moves vertex v of the range to remap[v] in every stream
+static void remapVertices(ModelData& data, const Submesh& range, const std::vector<GLuint>& remap) {
+    for (const VertexStream& stream : data.streams) {
+        if (stream.size == 0 || range.vertexCount == 0) {
+            continue;
+        }
+        size_t elementSize = stream.size * componentSize(stream.type);
+        unsigned char* first = data.vertexBytes.data() + stream.offset + size_t(range.baseVertex) * stream.stride;
+        std::vector<unsigned char> old(first, first + size_t(range.vertexCount - 1) * stream.stride + elementSize);
+        for (size_t v = 0; v < range.vertexCount; v++) {
+            memcpy(first + size_t(remap[v]) * stream.stride, old.data() + v * stream.stride, elementSize);
+        }
+    }
+}
+
+// Local transform of a glTF node, from its matrix when it has one. glTF node matrices
+// hold no shear or projection, so the matrix is split by hand: glm 0.9.7's decompose()
+// returns the conjugate rotation and mishandles mirroring.
+static void nodeTransform(const tinygltf::Node& node, glm::vec3& translation, glm::quat& rotation, glm::vec3& scale) {
+    translation = glm::vec3(0.0f);
+    rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    scale = glm::vec3(1.0f);
+    if (node.matrix.size() == 16) {
+        float values[16];
+        std::copy(node.matrix.begin(), node.matrix.end(), values);
+        glm::mat4 matrix = glm::make_mat4(values);
+        translation = glm::vec3(matrix[3]);
+
+        // Scale is the length of each basis column. A mirrored basis gets its one
+        // negative scale on x, which leaves a proper rotation in the columns.
+        glm::mat3 basis(matrix);
+        for (int axis = 0; axis < 3; axis++) {
+            scale[axis] = glm::length(basis[axis]);
+        }
+        if (glm::determinant(basis) < 0.0f) {
+            scale.x = -scale.x;
+        }
+        for (int axis = 0; axis < 3; axis++) {
+            if (scale[axis] != 0.0f) {
+                basis[axis] /= scale[axis];
+            }
+        }
+        rotation = glm::normalize(glm::quat_cast(basis));
+        return;
+    }
+    if (node.translation.size() == 3) {
+        translation = glm::vec3(node.translation[0], node.translation[1], node.translation[2]);
+    }
+    if (node.rotation.size() == 4) {
+        // glTF stores x, y, z, w
+        rotation = glm::quat(float(node.rotation[3]), float(node.rotation[0]), float(node.rotation[1]), float(node.rotation[2]));
+    }
+    if (node.scale.size() == 3) {
+        scale = glm::vec3(node.scale[0], node.scale[1], node.scale[2]);
+    }
+}
+
+// Appends the subtree below a glTF node depth first, so parents precede their children.
+// nodeMeshes gets the glTF mesh of every appended node.
+static void flattenNode(NodeHierarchy& nodes, std::vector<int>& nodeMeshes, std::vector<bool>& visited,
+                        const tinygltf::Model& model, int index, int parent) {
+    if (index < 0 || index >= int(model.nodes.size()) || visited[index]) {
+        return;
+    }
+    visited[index] = true;
+
+    const tinygltf::Node& node = model.nodes[index];
+    glm::vec3 translation, scale;
+    glm::quat rotation;
+    nodeTransform(node, translation, rotation, scale);
+    int flat = nodes.add(parent, node.name, translation, rotation, scale);
+    nodeMeshes.push_back(node.mesh);
+    for (int child : node.children) {
+        flattenNode(nodes, nodeMeshes, visited, model, child, flat);
+    }
+}
+
+// Merges the triangle primitives of every mesh the nodes use into one set of vertex streams and
+// one index buffer, then gives each node a submesh per primitive of its mesh
+static void processPrimitives(ModelData& data, const tinygltf::Model& model, const std::vector<int>& nodeMeshes,
+                              const VertexFormat& format) {
+    // Each mesh once, however many nodes use it. Only triangle lists are drawn, and every
+    // primitive needs positions.
+    std::vector<const tinygltf::Primitive*> primitives;
+    std::vector<std::vector<size_t>> meshPrimitives(model.meshes.size());
+    std::vector<bool> gathered(model.meshes.size(), false);
+    for (int mesh : nodeMeshes) {
+        if (mesh < 0 || mesh >= int(model.meshes.size()) || gathered[mesh]) {
+            continue;
+        }
+        gathered[mesh] = true;
+        for (const tinygltf::Primitive& primitive : model.meshes[mesh].primitives) {
+            if ((primitive.mode != -1 && primitive.mode != TINYGLTF_MODE_TRIANGLES)
+                || !findAccessor(model, primitive, "POSITION")) {
+                continue;
+            }
+            meshPrimitives[mesh].push_back(primitives.size());
+            primitives.push_back(&primitive);
+        }
+    }
+
+    // Vertex ranges first, every stream numbers the vertices the same way
+    std::vector<Submesh> ranges;
+    std::vector<glm::vec3> rangeMin, rangeMax;
+    for (const tinygltf::Primitive* primitive : primitives) {
+        const tinygltf::Accessor& position = *findAccessor(model, *primitive, "POSITION");
+        Submesh range;
+        range.baseVertex = static_cast<uint32_t>(data.vertexCount);
+        range.vertexCount = static_cast<uint32_t>(position.count);
+        range.material = primitive->material;
+        data.vertexCount += position.count;
+        ranges.push_back(range);
+
+        // Bounds from the min and max glTF requires on positions, read from the data otherwise
+        glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+        if (position.minValues.size() == 3 && position.maxValues.size() == 3) {
+            boundsMin = glm::vec3(position.minValues[0], position.minValues[1], position.minValues[2]);
+            boundsMax = glm::vec3(position.maxValues[0], position.maxValues[1], position.maxValues[2]);
+        } else {
+            size_t stride;
+            const unsigned char* source = accessorData(model, position, stride);
+            size_t componentSize = tinygltf::GetComponentSizeInBytes(position.componentType);
+            for (size_t v = 0; source && v < position.count; v++) {
+                glm::vec3 p;
+                for (int c = 0; c < 3; c++) {
+                    p[c] = readComponent(source + v * stride + c * componentSize, position.componentType, position.normalized);
+                }
+                boundsMin = glm::min(boundsMin, p);
+                boundsMax = glm::max(boundsMax, p);
+            }
+        }
+        rangeMin.push_back(boundsMin);
+        rangeMax.push_back(boundsMax);
+    }
+
+    // Base color of every material a submesh uses, decoded once each
+    data.materials.clear();
+    data.materials.resize(model.materials.size());
+    std::vector<bool> decoded(model.materials.size(), false);
+    for (const Submesh& range : ranges) {
+        if (range.material < 0 || decoded[range.material]) {
+            continue;
+        }
+        decoded[range.material] = true;
+        int textureIndex = model.materials[range.material].pbrMetallicRoughness.baseColorTexture.index;
+        if (textureIndex >= 0) {
+            decodeTexture(data.materials[range.material], data, model, textureIndex);
+        }
+    }
+
+    // Attributes left in their glTF format are copied, the others quantised
+    bool source[MODEL_ATTRIBUTE_COUNT] = { format.position == POSITION_SOURCE, format.normal == NORMAL_SOURCE,
+                                           format.texcoord == TEXCOORD_SOURCE };
+    data.vertexBytes.clear();
+    data.decoding = VertexDecoding();
+    for (int attribute = 0; attribute < MODEL_ATTRIBUTE_COUNT; attribute++) {
+        if (source[attribute]) {
+            buildStream(data, model, primitives, ranges, attribute);
+        } else {
+            encodeStream(data, model, primitives, ranges, attribute, format);
+        }
+    }
+
+    // Indices stay relative to their primitive, the submesh base vertex offsets them when
+    // drawing. Primitives without indices draw their vertices in order.
+    std::vector<GLuint>& indices = data.indices;
+    for (size_t i = 0; i < primitives.size(); i++) {
+        Submesh& range = ranges[i];
+        range.firstIndex = static_cast<uint32_t>(indices.size());
+
+        if (primitives[i]->indices < 0) {
+            for (uint32_t v = 0; v < range.vertexCount; v++) {
+                indices.push_back(v);
+            }
+        } else {
+            const tinygltf::Accessor& indexAccessor = model.accessors[primitives[i]->indices];
+            size_t stride;
+            const unsigned char* source = accessorData(model, indexAccessor, stride);
+            indices.reserve(indices.size() + indexAccessor.count);
+            for (size_t j = 0; source && j < indexAccessor.count; j++) {
+                const unsigned char* index = source + j * stride;
+                switch (indexAccessor.componentType) {
+                    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+                        indices.push_back(index[0]);
+                        break;
+                    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+                        uint16_t value;
+                        memcpy(&value, index, sizeof(value));
+                        indices.push_back(value);
+                        break;
+                    }
+                    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: {
+                        uint32_t value;
+                        memcpy(&value, index, sizeof(value));
+                        indices.push_back(value);
+                        break;
+                    }
+                }
+            }
+        }
+        range.indexCount = static_cast<uint32_t>(indices.size()) - range.firstIndex;
+    }
+
+    // Triangle order for the post-transform cache and overdraw, then vertex order for fetch.
+    // Cooked with the mesh, so it runs once per source file.
+    std::vector<float> positions = readAttribute(model, primitives, ranges, data.vertexCount, ATTRIBUTE_POSITION, 3);
+    std::vector<bool> optimized(ranges.size(), false);
+    for (size_t i = 0; i < ranges.size(); i++) {
+        const Submesh& range = ranges[i];
+        GLuint* first = indices.data() + range.firstIndex;
+        if (std::any_of(first, first + range.indexCount, [&](GLuint index) { return index >= range.vertexCount; })) {
+            continue;
+        }
+        float* rangePositions = positions.data() + size_t(range.baseVertex) * 3;
+        OptimizeVertexCache(first, range.indexCount, range.vertexCount);
+        OptimizeOverdraw(first, range.indexCount, rangePositions, range.vertexCount);
+        std::vector<GLuint> remap = OptimizeVertexFetch(first, range.indexCount, range.vertexCount);
+        remapVertices(data, range, remap);
+        std::vector<float> old(rangePositions, rangePositions + size_t(range.vertexCount) * 3);
+        for (size_t v = 0; v < range.vertexCount; v++) {
+            std::copy(old.begin() + v * 3, old.begin() + v * 3 + 3, rangePositions + size_t(remap[v]) * 3);
+        }
+        optimized[i] = true;
+    }
+
+    // Levels of detail, each with half the triangles of the one before, appended after the full
+    // indices and drawn with the same vertices. A primitive stops when simplifying no longer
+    // pays off and repeats its last level from there, so every primitive has as many levels.
+    std::vector<std::vector<MeshLod>> rangeLods(ranges.size());
+    std::vector<std::vector<float>> rangeErrors(ranges.size());
+    size_t lodCount = 0;
+    for (size_t i = 0; i < ranges.size(); i++) {
+        const Submesh& range = ranges[i];
+        MeshLod full;
+        full.firstIndex = range.firstIndex;
+        full.indexCount = range.indexCount;
+        rangeLods[i].push_back(full);
+        rangeErrors[i].push_back(0.0f);
+
+        MeshSimplifier simplifier(indices.data() + range.firstIndex, optimized[i] ? range.indexCount : 0,
+                                  positions.data() + size_t(range.baseVertex) * 3, range.vertexCount);
+        for (size_t level = 1; level < MaxLodCount && optimized[i]; level++) {
+            size_t previous = rangeLods[i].back().indexCount;
+            if (!simplifier.simplify(previous / 6 * 3)) {
+                break;
+            }
+            std::vector<GLuint> lod = simplifier.indices();
+            if (lod.empty() || lod.size() > previous * LodMinReduction) {
+                break;
+            }
+            OptimizeVertexCache(lod.data(), lod.size(), range.vertexCount);
+            MeshLod entry;
+            entry.firstIndex = static_cast<uint32_t>(indices.size());
+            entry.indexCount = static_cast<uint32_t>(lod.size());
+            indices.insert(indices.end(), lod.begin(), lod.end());
+            rangeLods[i].push_back(entry);
+            rangeErrors[i].push_back(simplifier.error());
+        }
+        lodCount = std::max(lodCount, rangeLods[i].size());
+    }
+    for (size_t i = 0; i < ranges.size(); i++) {
+        rangeLods[i].resize(lodCount, rangeLods[i].back());
+        rangeErrors[i].resize(lodCount, rangeErrors[i].back());
+        ranges[i].lod = static_cast<uint32_t>(data.lods.size());
+        data.lods.insert(data.lods.end(), rangeLods[i].begin(), rangeLods[i].end());
+    }
+
+    // Base vertices keep indices small, 16 bits usually do
+    bool narrow = std::all_of(ranges.begin(), ranges.end(), [](const Submesh& range) { return range.vertexCount <= 65536; });
+    if (narrow) {
+        data.shortIndices.assign(indices.begin(), indices.end());
+    }
+
+    // A submesh for every primitive each node places, bounded by the corners of the primitive's
+    // box in model space. The error of a level is the worst of its submeshes, scaled like them.
+    data.lodErrors.assign(lodCount, 0.0f);
+    for (size_t node = 0; node < nodeMeshes.size(); node++) {
+        if (nodeMeshes[node] < 0 || nodeMeshes[node] >= int(model.meshes.size())) {
+            continue;
+        }
+        const glm::mat4& world = data.nodes.world(static_cast<int>(node));
+        float scale = std::max(glm::length(glm::vec3(world[0])), std::max(glm::length(glm::vec3(world[1])),
+                                                                          glm::length(glm::vec3(world[2]))));
+        for (size_t i : meshPrimitives[nodeMeshes[node]]) {
+            Submesh submesh = ranges[i];
+            submesh.node = static_cast<int32_t>(node);
+            data.submeshes.push_back(submesh);
+            for (size_t level = 0; level < lodCount; level++) {
+                data.lodErrors[level] = std::max(data.lodErrors[level], rangeErrors[i][level] * scale);
+            }
+
+            for (int corner = 0; corner < 8; corner++) {
+                glm::vec3 local((corner & 1) ? rangeMax[i].x : rangeMin[i].x, (corner & 2) ? rangeMax[i].y : rangeMin[i].y,
+                                (corner & 4) ? rangeMax[i].z : rangeMin[i].z);
+                glm::vec3 p = glm::vec3(world * glm::vec4(local, 1.0f));
+                data.boundsMin = glm::min(data.boundsMin, p);
+                data.boundsMax = glm::max(data.boundsMax, p);
+            }
+        }
+    }
+
+    // Draw order groups submeshes by material, otherwise keeping the file's order
+    std::stable_sort(data.submeshes.begin(), data.submeshes.end(), [](const Submesh& a, const Submesh& b) {
+        return a.material < b.material;
+    });
+}
+
+void ModelAsset::bindVertexAttributes() const {
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+
+    // Attributes the mesh lacks stay disabled and read as (0, 0, 0, 1)
+    for (GLuint attribute = 0; attribute < MODEL_ATTRIBUTE_COUNT; attribute++) {
+        const VertexStream& stream = streams[attribute];
+        if (stream.size == 0) {
+            glDisableVertexAttribArray(attribute);
+            continue;
+        }
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribPointer(attribute, stream.size, stream.type, static_cast<GLboolean>(stream.normalized),
+                              stream.stride, (void*)stream.offset);
+    }
+}
+
+bool ModelAsset::decode(const std::string& path, ModelData& data, const VertexFormat& format) {
+    data.path = path;
+
+    // A cached cook needs no parsing at all, only the texture is read
+    DerivedDataKey key = CookedMeshKey(path, format);
+    if (ReadCookedMesh(key, data)) {
+        for (MaterialData& material : data.materials) {
+            if (!material.texturePath.empty()) {
+                material.texture = ReadTextureImage(material.texturePath);
+                if (!material.texture.valid()) {
+                    std::cout << "Failed to decode base color texture of " << data.path << std::endl;
+                }
+            }
+        }
+        return true;
+    }
+
+    tinygltf::Model model;
+    tinygltf::TinyGLTF loader;
+    std::string err;
+    std::string warn;
+    loader.SetImageLoader(keepImageData, nullptr);
+    loader.SetFsCallbacks({ virtualFileExists, tinygltf::ExpandFilePath, readVirtualFile, tinygltf::WriteWholeFile,
+                            virtualFileSize, nullptr });
+
+    // Load glTF file
+    bool ret = loader.LoadASCIIFromFile(&model, &err, &warn, path);
+
+    if (!warn.empty()) {
+        std::cout << "Warning: " << warn << std::endl;
+    }
+    if (!err.empty()) {
+        std::cout << "Error: " << err << std::endl;
+    }
+    if (!ret) {
+        std::cout << "Failed to load glTF file: " << path << std::endl;
+        return false;
+    }
+    for (const std::string& extension : model.extensionsRequired) {
+        if (extension != "KHR_mesh_quantization") {
+            std::cout << "Unsupported glTF extension " << extension << " required by " << path << std::endl;
+            return false;
+        }
+    }
+
+    // Process scene, the whole node tree below its roots
+    std::vector<int> nodeMeshes;
+    std::vector<bool> visited(model.nodes.size(), false);
+    if (!model.scenes.empty()) {
+        const tinygltf::Scene& scene = model.scenes[model.defaultScene >= 0 ? model.defaultScene : 0];
+        for (int root : scene.nodes) {
+            flattenNode(data.nodes, nodeMeshes, visited, model, root, -1);
+        }
+    }
+    data.nodes.update();
+    processPrimitives(data, model, nodeMeshes, format);
+    data.vertexData = data.vertexBytes.data();
+    data.vertexDataSize = data.vertexBytes.size();
+    data.indexCount = data.indices.size();
+    if (!data.shortIndices.empty() || data.indices.empty()) {
+        data.indexData = data.shortIndices.data();
+        data.indexType = GL_UNSIGNED_SHORT;
+    } else {
+        data.indexData = data.indices.data();
+        data.indexType = GL_UNSIGNED_INT;
+    }
+
+    // Cook on first load, the next start maps the result instead
+    if (!WriteCookedMesh(key, data)) {
+        std::cout << "Could not write cooked mesh for " << path << std::endl;
+    }
+    return true;
+}
+
+ModelAsset::~ModelAsset() {
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+}
+
+// Weak references, so the cache itself never keeps an asset alive
+static std::unordered_map<std::string, std::weak_ptr<ModelAsset>>& cache() {
+    static std::unordered_map<std::string, std::weak_ptr<ModelAsset>> assets;
+    return assets;
+}
+
+std::shared_ptr<ModelAsset> ModelAsset::acquire(const std::string& path) {
+    auto it = cache().find(path);
+    if (it != cache().end()) {
+        if (std::shared_ptr<ModelAsset> asset = it->second.lock()) {
+            return asset;
+        }
+    }
+
+    ModelData data;
+    if (!decode(path, data)) {
+        return nullptr;
+    }
+    return create(data);
+}
+
+static TextureSampling baseColorSampling() {
+    TextureSampling sampling;
+    sampling.minFilter = GL_LINEAR;
+    sampling.mipmaps = false;
+    return sampling;
+}
+
+void ModelAsset::upload(const ModelData& data) {
+    path = data.path;
+    submeshes = data.submeshes;
+    lods = data.lods;
+    lodErrors = data.lodErrors;
+    nodes = data.nodes;
+    std::copy(data.streams, data.streams + MODEL_ATTRIBUTE_COUNT, streams);
+    decoding = data.decoding;
+    boundsMin = data.boundsMin;
+    boundsMax = data.boundsMax;
+
+    // Fill vertex buffer
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, data.vertexDataSize, data.vertexData, GL_STATIC_DRAW);
+
+    // Fill element buffer. Bound as an array buffer, no VAO is bound on this context.
+    glGenBuffers(1, &EBO);
+    glBindBuffer(GL_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ARRAY_BUFFER, data.indexCount * IndexSize(data.indexType), data.indexData, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    indexCount = static_cast<GLsizei>(data.indexCount);
+    indexType = data.indexType;
+
+    // A missing image file still gets the white fallback, like TextureManager::load.
+    // Materials sharing an image file share its texture.
+    materials.assign(data.materials.size(), ModelMaterial());
+    for (size_t i = 0; i < data.materials.size(); i++) {
+        const MaterialData& source = data.materials[i];
+        ModelMaterial& material = materials[i];
+        material.texturePath = source.texturePath;
+        for (size_t j = 0; j < i && !material.texturePath.empty(); j++) {
+            if (materials[j].texturePath == material.texturePath) {
+                material.texture = materials[j].texture;
+                break;
+            }
+        }
+        if (!material.texture && (!material.texturePath.empty() || source.texture.valid())) {
+            material.texture = UploadTexture(source.texture, baseColorSampling());
+        }
+    }
+}
+
+void ModelAsset::publish(const std::shared_ptr<ModelAsset>& asset) {
+    // Image files are shared with every other asset that references them
+    for (ModelMaterial& material : asset->materials) {
+        if (!material.texture) {
+            continue;
+        }
+        if (!material.texturePath.empty()) {
+            material.texture = TextureManager::adopt(material.texturePath, material.texture, baseColorSampling());
+        } else {
+            TextureManager::track(material.texture);
+        }
+    }
+
+    glGenVertexArrays(1, &asset->VAO);
+    glBindVertexArray(asset->VAO);
+    asset->bindVertexAttributes();
+    glBindVertexArray(0);
+
+    cache()[asset->path] = asset;
+}
+
+std::shared_ptr<ModelAsset> ModelAsset::create(const ModelData& data) {
+    // The CPU-side copies only live until the GPU buffers are filled
+    std::shared_ptr<ModelAsset> asset = std::make_shared<ModelAsset>();
+    asset->upload(data);
+    publish(asset);
+    return asset;
+}
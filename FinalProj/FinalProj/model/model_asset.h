@@ -0,0 +1,202 @@
+#ifndef MODEL_ASSET_H
+#define MODEL_ASSET_H
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "glad/gl.h"
+#include <asset/mapped_file.h>
+#include <render/texture_manager.h>
+#include "node_hierarchy.h"
+
+// Bytes per index of GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+inline size_t IndexSize(GLenum indexType) {
+    return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(GLuint);
+}
+
+// Vertex attribute locations of the model shaders
+enum ModelAttribute {
+    ATTRIBUTE_POSITION = 0,
+    ATTRIBUTE_NORMAL = 1,
+    ATTRIBUTE_TEXCOORD = 2,
+    MODEL_ATTRIBUTE_COUNT = 3
+};
+
+// Format and place of one attribute in the vertex buffer, as glVertexAttribPointer takes it.
+// Each attribute is its own stream holding every vertex of the asset, so vertex i of a
+// stream sits at offset + i * stride whatever the other streams look like.
+struct VertexStream {
+    int32_t size = 0;               // Components per vertex, 0 when the mesh lacks the attribute
+    uint32_t type = GL_FLOAT;
+    uint32_t normalized = GL_FALSE;
+    uint32_t stride = 0;
+    uint64_t offset = 0;
+};
+
+// How decode() stores each vertex attribute. SOURCE keeps the format of the glTF, floats or the
+// integers of KHR_mesh_quantization, and uploads the accessor bytes as they are. The compact
+// formats are quantised over the range the asset actually uses, see VertexDecoding.
+enum PositionFormat : uint32_t {
+    POSITION_SOURCE = 0,
+    POSITION_HALF = 1,          // 3 half floats, padded to 8 bytes
+    POSITION_SNORM16 = 2        // 3 normalised int16 over the bounding box, padded to 8 bytes
+};
+
+enum NormalFormat : uint32_t {
+    NORMAL_SOURCE = 0,
+    NORMAL_OCTAHEDRAL16 = 1     // Octahedral mapping in 2 normalised int16
+};
+
+enum TexcoordFormat : uint32_t {
+    TEXCOORD_SOURCE = 0,
+    TEXCOORD_HALF = 1,          // 2 half floats
+    TEXCOORD_UNORM16 = 2        // 2 normalised uint16 over the texcoord range
+};
+
+struct VertexFormat {
+    PositionFormat position = POSITION_SNORM16;
+    NormalFormat normal = NORMAL_OCTAHEDRAL16;
+    TexcoordFormat texcoord = TEXCOORD_UNORM16;
+};
+
+// Undoes the quantisation in the vertex shader: position = positionOffset + positionScale *
+// stored position, texcoords likewise, and normals are unfolded when octahedral. The identity
+// for SOURCE and half floats.
+struct VertexDecoding {
+    glm::vec3 positionOffset = glm::vec3(0.0f);
+    glm::vec3 positionScale = glm::vec3(1.0f);
+    glm::vec2 texcoordOffset = glm::vec2(0.0f);
+    glm::vec2 texcoordScale = glm::vec2(1.0f);
+    uint32_t octahedralNormals = 0;
+};
+
+// One glTF primitive inside the merged buffers, placed by a node. Its indices count from
+// baseVertex, so it is drawn with glDrawElementsBaseVertex. A mesh used by several nodes has
+// a submesh per node, all sharing the same indices and vertices.
+struct Submesh {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    uint32_t baseVertex = 0;
+    uint32_t vertexCount = 0;
+    int32_t material = -1;      // glTF material index, -1 for none
+    int32_t node = -1;          // Index into the node hierarchy, -1 for none
+    uint32_t lod = 0;           // First of its levels of detail in the asset's lods, one per level
+};
+
+// Indices of one level of detail of a submesh, a simplification of its full index range over the
+// same vertices, drawn with the submesh's base vertex. Level 0 is the full range.
+struct MeshLod {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+};
+
+// Base color of one glTF material as decoded for upload
+struct MaterialData {
+    std::string texturePath;    // Base color image file, empty when the image is embedded or absent
+    Image texture;              // Decoded base color image, invalid when there is none
+};
+
+// Base color of one glTF material on the GPU
+struct ModelMaterial {
+    std::string texturePath;    // Cache key of texture, empty when the image was embedded
+    TextureHandle texture;
+};
+
+// CPU-side contents of a glTF file. Produced by ModelAsset::decode, which does not touch GL
+// and may run on a worker thread.
+struct ModelData {
+    std::string path;
+
+    // Built while parsing the glTF, empty when the mesh came from a cooked file
+    std::vector<unsigned char> vertexBytes;
+    std::vector<GLuint> indices;
+    std::vector<uint16_t> shortIndices;     // indices narrowed, when no primitive has over 65536 vertices
+    VertexStream streams[MODEL_ATTRIBUTE_COUNT];
+    VertexDecoding decoding;
+
+    // Mesh contents to upload. Point either into the vectors above or straight into cooked.
+    const unsigned char* vertexData = nullptr;
+    size_t vertexDataSize = 0;
+    size_t vertexCount = 0;
+    const void* indexData = nullptr;
+    size_t indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;     // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    std::shared_ptr<MappedFile> cooked;
+
+    // Sorted by material, so drawing them in order binds each texture once
+    std::vector<Submesh> submeshes;
+    std::vector<MeshLod> lods;          // lodErrors.size() entries for each submesh, from Submesh::lod on
+    std::vector<float> lodErrors;       // Geometric error of each level in model space, level 0 has none
+    std::vector<MaterialData> materials;
+    NodeHierarchy nodes;        // Scene nodes in their rest pose, world matrices up to date
+
+    // Around every submesh as its node places it
+    glm::vec3 boundsMin = glm::vec3(FLT_MAX);
+    glm::vec3 boundsMax = glm::vec3(-FLT_MAX);
+};
+
+// Mesh and texture data for one glTF file, shared by every Model that loads it.
+// Assets are cached by path and freed once the last Model referencing them is gone.
+struct ModelAsset {
+    std::string path;
+    GLuint VAO = 0, VBO = 0, EBO = 0;
+    std::vector<Submesh> submeshes;     // Sorted by material
+    std::vector<MeshLod> lods;
+    std::vector<float> lodErrors;       // Increasing, see ModelData
+    std::vector<ModelMaterial> materials;
+    NodeHierarchy nodes;                // Rest pose, copied by each Model to pose on its own
+    VertexStream streams[MODEL_ATTRIBUTE_COUNT];
+    VertexDecoding decoding;
+    glm::vec3 boundsMin = glm::vec3(0.0f), boundsMax = glm::vec3(0.0f);
+    GLsizei indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+
+    ~ModelAsset();
+
+    // Base color texture of a material, 0 when it has none
+    GLuint textureID(int material) const {
+        return material >= 0 && material < int(materials.size()) && materials[material].texture
+            ? materials[material].texture->id : 0;
+    }
+
+    int lodCount() const { return static_cast<int>(lodErrors.size()); }
+
+    // Indices of submesh at level, clamped to the levels there are
+    MeshLod lod(const Submesh& submesh, int level) const {
+        if (lodErrors.empty()) {
+            MeshLod full;
+            full.firstIndex = submesh.firstIndex;
+            full.indexCount = submesh.indexCount;
+            return full;
+        }
+        return lods[submesh.lod + std::min(std::max(level, 0), lodCount() - 1)];
+    }
+
+    // Binds the mesh buffers and the streams to attributes 0-2 of the currently bound VAO
+    void bindVertexAttributes() const;
+
+    // Returns the cached asset for path, loading it on first use. Returns nullptr on failure.
+    static std::shared_ptr<ModelAsset> acquire(const std::string& path);
+
+    // Reads, parses and decodes path into data without any GL calls. Safe to call from any thread.
+    // The mesh is mapped from the derived data cache when it is there, and cooked otherwise.
+    // Files needing a glTF extension other than KHR_mesh_quantization are refused.
+    static bool decode(const std::string& path, ModelData& data, const VertexFormat& format = VertexFormat());
+
+    // Uploads decoded data and caches the result under data.path, both steps below at once
+    static std::shared_ptr<ModelAsset> create(const ModelData& data);
+
+    // Fills the buffers and base color textures on whichever context is current, which may be
+    // the UploadContext. The asset cannot be drawn until it has been published.
+    void upload(const ModelData& data);
+
+    // Render thread, once the upload has completed. Builds the VAO, as VAOs are not shared
+    // between contexts, and hands textures and asset to their caches.
+    static void publish(const std::shared_ptr<ModelAsset>& asset);
+};
+
+#endif
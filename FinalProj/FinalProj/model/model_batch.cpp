@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <iostream>
+#include <render/shader.h>
+#include "glad/gl.h"
+#include "model_batch.h"
+
+// Share of the impostor distance over which mesh and impostor cross-fade
+static const float ImpostorFadeBand = 0.1f;
+
+// How an instance is drawn, both while cross-fading
+enum DrawMode : uint8_t {
+    DRAW_MESH = 1,
+    DRAW_IMPOSTOR = 2
+};
+
+void ModelInstance::setPosition(const glm::vec3& position) {
+    batch->transform(index) = glm::translate(glm::mat4(1.0f), position);
+}
+
+void ModelInstance::setRotation(float angle, const glm::vec3& axis) {
+    glm::mat4& m = batch->transform(index);
+    m = glm::rotate(m, glm::radians(angle), axis);
+}
+
+void ModelInstance::setScale(const glm::vec3& scale) {
+    glm::mat4& m = batch->transform(index);
+    m = glm::scale(m, scale);
+}
+
+void ModelInstance::translate(glm::vec3 movement) {
+    glm::mat4& m = batch->transform(index);
+    m = glm::translate(m, movement);
+}
+
+
+ModelBatch::ModelBatch() {
+    program.reflect(LoadShadersFromFile("../FinalProj/model/model_instanced.vert", "../FinalProj/model/model.frag"));
+    if (!program.valid()) {
+        std::cerr << "Failed to load instanced model shaders." << std::endl;
+    }
+    uniforms.locate(program);
+    impostorFadeUniform = program.uniform("impostorFade");
+    fadeCentreUniform = program.uniform("fadeCentre");
+}
+
+ModelBatch::~ModelBatch() {
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &instanceVBO);
+    ReleaseShaders(program.id());
+}
+
+bool ModelBatch::loadModel(const std::string& path) {
+    asset = ModelAsset::acquire(path);
+    if (!asset) return false;
+    nodes = asset->nodes;
+
+    // Own VAO: shares the asset's vertex and index buffers, adds the instance buffer
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &instanceVBO);
+    glBindVertexArray(VAO);
+    asset->bindVertexAttributes();
+
+    // Instance transform, one mat4 split over four vec4 attributes
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    for (GLuint i = 0; i < 4; i++) {
+        glEnableVertexAttribArray(3 + i);
+        glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(sizeof(glm::vec4) * i));
+        glVertexAttribDivisor(3 + i, 1);
+    }
+
+    glBindVertexArray(0);
+    return true;
+}
+
+ModelInstance ModelBatch::addInstance(const glm::mat4& transform) {
+    transforms.push_back(transform);
+    lods.push_back(0);
+    modes.push_back(DRAW_MESH);
+    dirty = true;
+    return ModelInstance(this, transforms.size() - 1);
+}
+
+glm::mat4& ModelBatch::transform(size_t index) {
+    dirty = true;
+    boundsDirty = true;
+    return transforms[index];
+}
+
+void ModelBatch::render(const LodView& view) {
+    if (!asset || transforms.empty()) return;
+
+    if (culler) {
+        culler->result(CULL_PASS_CAMERA).mark(cullBoxes, visible);
+    }
+
+    // Each placement picks its own level of detail, or the impostor beyond impostorDistance,
+    // and both while they cross-fade. Culled ones are drawn neither way.
+    glm::vec3 centre = (asset->boundsMin + asset->boundsMax) * 0.5f;
+    glm::vec2 fade(impostorDistance, impostorDistance * (1.0f + ImpostorFadeBand));
+    for (size_t i = 0; i < transforms.size(); i++) {
+        bool culled = culler && i < visible.size() && !visible[i];
+        uint8_t mode = DRAW_MESH;
+        if (culled) {
+            mode = 0;
+        } else if (impostor) {
+            float distance = glm::length(glm::vec3(transforms[i] * glm::vec4(centre, 1.0f)) - view.position);
+            mode = (distance < fade.y ? DRAW_MESH : 0) | (distance > fade.x ? DRAW_IMPOSTOR : 0);
+        }
+        int lod = (mode & DRAW_MESH) ? SelectLod(*asset, transforms[i], view, lods[i]) : lods[i];
+        if (lod != lods[i] || mode != modes[i]) {
+            lods[i] = lod;
+            modes[i] = mode;
+            dirty = true;
+        }
+    }
+
+    // Re-upload instance transforms only when one of them changed or moved to another group
+    size_t levels = std::max(asset->lodCount(), 1);
+    if (dirty) {
+        groupFirst.assign(levels + 2, 0);
+        for (size_t i = 0; i < transforms.size(); i++) {
+            if (modes[i] & DRAW_MESH) {
+                groupFirst[lods[i] + 1]++;
+            }
+            if (modes[i] & DRAW_IMPOSTOR) {
+                groupFirst[levels + 1]++;
+            }
+        }
+        for (size_t group = 0; group <= levels; group++) {
+            groupFirst[group + 1] += groupFirst[group];
+        }
+        std::vector<size_t> fill(groupFirst.begin(), groupFirst.end() - 1);
+        grouped.resize(groupFirst.back());
+        for (size_t i = 0; i < transforms.size(); i++) {
+            if (modes[i] & DRAW_MESH) {
+                grouped[fill[lods[i]]++] = transforms[i];
+            }
+            if (modes[i] & DRAW_IMPOSTOR) {
+                grouped[fill[levels]++] = transforms[i];
+            }
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        if (grouped.size() > instanceCapacity) {
+            instanceCapacity = grouped.size();
+            glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, 0, grouped.size() * sizeof(glm::mat4), grouped.data());
+        dirty = false;
+    }
+
+    program.use();
+    nodes.update();
+    ShaderProgram::set(impostorFadeUniform, impostor ? fade : glm::vec2(0.0f));
+    ShaderProgram::set(fadeCentreUniform, centre);
+
+    // Draw the placements of each level at once, one call per submesh
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    for (size_t level = 0; level < levels; level++) {
+        size_t count = groupFirst[level + 1] - groupFirst[level];
+        if (count == 0) {
+            continue;
+        }
+        for (GLuint i = 0; i < 4; i++) {
+            size_t offset = groupFirst[level] * sizeof(glm::mat4) + sizeof(glm::vec4) * i;
+            glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)offset);
+        }
+        uniforms.drawSubmeshes(*asset, nodes, glm::mat4(1.0f), static_cast<GLsizei>(count), static_cast<int>(level));
+    }
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+
+    // Then the far placements, one quad each
+    if (impostor) {
+        impostor->render(instanceVBO, groupFirst[levels], static_cast<GLsizei>(groupFirst[levels + 1] - groupFirst[levels]),
+                         fade);
+    }
+}
+
+void ModelBatch::attachCulling(FrustumCuller& culler) {
+    this->culler = &culler;
+    cullBoxes = culler.add(static_cast<uint32_t>(transforms.size()));
+    boundsDirty = true;
+    updateBounds();
+}
+
+void ModelBatch::updateBounds() {
+    if (!culler || !asset || !boundsDirty) return;
+    for (size_t i = 0; i < cullBoxes.count; i++) {
+        culler->set(cullBoxes.first + static_cast<uint32_t>(i), asset->boundsMin, asset->boundsMax, transforms[i]);
+    }
+    boundsDirty = false;
+}
+
+bool ModelBatch::enableImpostor(float distance) {
+    if (!asset) return false;
+
+    nodes.update();
+    std::unique_ptr<Impostor> baked(new Impostor());
+    if (!baked->bake(*asset, nodes)) {
+        return false;
+    }
+    impostor = std::move(baked);
+    impostorDistance = distance;
+    dirty = true;
+    return true;
+}
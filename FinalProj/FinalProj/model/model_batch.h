@@ -0,0 +1,88 @@
+#ifndef MODEL_BATCH_H
+#define MODEL_BATCH_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "glad/gl.h"
+#include "model.h"
+#include "model_asset.h"
+#include "impostor.h"
+
+class ModelBatch;
+
+// Handle to one placement of a ModelBatch asset. Transforms behave like the Model setters.
+class ModelInstance {
+public:
+    ModelInstance() = default;
+
+    void setPosition(const glm::vec3& position);
+    void setRotation(float angle, const glm::vec3& axis);
+    void setScale(const glm::vec3& scale);
+    void translate(glm::vec3 movement);
+
+private:
+    friend class ModelBatch;
+    ModelInstance(ModelBatch* batch, size_t index) : batch(batch), index(index) {}
+
+    ModelBatch* batch = nullptr;
+    size_t index = 0;
+};
+
+// Every placement of one glTF asset, drawn with one glDrawElementsInstancedBaseVertex call
+// per submesh and level of detail in use.
+// Instance transforms live in a per-instance matrix buffer bound to attributes 3-6, applied on
+// top of the node transform of each submesh. The buffer holds them grouped by level, then the
+// ones drawn as impostors, and each group is drawn with the attributes pointed at its part of
+// the buffer. With culling attached, placements the camera pass does not see are left out.
+class ModelBatch {
+public:
+    ShaderProgram program;
+    NodeHierarchy nodes;    // Pose of the asset's node tree, shared by every instance
+
+    ModelBatch();
+    ~ModelBatch();
+    ModelBatch(const ModelBatch&) = delete;
+    ModelBatch& operator=(const ModelBatch&) = delete;
+
+    bool loadModel(const std::string& path);
+    ModelInstance addInstance(const glm::mat4& transform = glm::mat4(1.0f));
+    size_t instanceCount() const { return transforms.size(); }
+    void render(const LodView& view);
+
+    // Gives every placement a box in culler. Placements added later are not culled.
+    void attachCulling(FrustumCuller& culler);
+    // Moves the boxes of placements whose transform changed, before the passes are culled
+    void updateBounds();
+    const CullRange& boxes() const { return cullBoxes; }
+
+    // Draws placements farther than distance from the camera as an impostor baked now from the
+    // current pose. Mesh and impostor cross-fade over the next tenth of that distance.
+    // Returns false when the impostor could not be baked.
+    bool enableImpostor(float distance);
+
+private:
+    friend class ModelInstance;
+    glm::mat4& transform(size_t index);
+
+    ModelUniforms uniforms;
+    std::shared_ptr<ModelAsset> asset;
+    std::vector<glm::mat4> transforms;
+    std::vector<int> lods;                  // Level of each instance last frame
+    std::vector<uint8_t> modes;             // DrawMode bits of each instance last frame
+    std::vector<glm::mat4> grouped;         // transforms as uploaded, by level then impostors
+    std::vector<size_t> groupFirst;         // Group g is grouped[groupFirst[g], groupFirst[g + 1]), impostors last
+    std::unique_ptr<Impostor> impostor;
+    float impostorDistance = 0.0f;
+    GLint impostorFadeUniform, fadeCentreUniform;
+    GLuint VAO = 0, instanceVBO = 0;
+    size_t instanceCapacity = 0;
+    bool dirty = true;
+    FrustumCuller* culler = nullptr;
+    CullRange cullBoxes;
+    std::vector<uint8_t> visible;           // Placements the camera pass saw this frame
+    bool boundsDirty = true;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#version 330 core
+
+layout (location = 0) in vec3 inPosition;
+layout (location = 1) in vec3 inNormal;
+layout (location = 2) in vec2 inTexCoords;
+layout (location = 3) in mat4 instanceModel;
+
+layout(std140) uniform FrameConstants {
+    mat4 viewProjection;
+    mat4 lightSpaceMatrix;
+    vec4 lightPosition;
+    vec4 lightIntensity;
+    vec4 viewPosition;
+};
+
+// Node transform of the submesh being drawn, below the instance transform
+uniform mat4 model;
+
+// Undoes the vertex quantisation, see VertexDecoding
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+uniform vec2 texcoordOffset;
+uniform vec2 texcoordScale;
+uniform bool octahedralNormals;
+
+// Instances fade out between impostorFade.x and .y from the camera, measured to fadeCentre in
+// model space, while their impostor fades in. (0, 0) when the batch has no impostor.
+uniform vec2 impostorFade;
+uniform vec3 fadeCentre;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+out float Fade;
+
+vec3 decodeNormal(vec3 stored) {
+    if (!octahedralNormals) {
+        return stored;
+    }
+    vec3 n = vec3(stored.xy, 1.0 - abs(stored.x) - abs(stored.y));
+    float fold = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -fold : fold;
+    n.y += n.y >= 0.0 ? -fold : fold;
+    return normalize(n);
+}
+
+void main() {
+    vec3 position = positionOffset + positionScale * inPosition;
+
+    // Calculate fragment position in world space
+    mat4 world = instanceModel * model;
+    vec4 worldPos = world * vec4(position, 1.0);
+    FragPos = vec3(worldPos);
+
+    // Calculate the position in clip space
+    gl_Position = viewProjection * worldPos;
+
+    // Transform normal vector to world space
+    Normal = mat3(transpose(inverse(world))) * decodeNormal(inNormal);
+
+    // Pass to frag shader
+    TexCoords = texcoordOffset + texcoordScale * inTexCoords;
+
+    Fade = 0.0;
+    if (impostorFade.y > impostorFade.x) {
+        float cameraDistance = length(viewPosition.xyz - vec3(instanceModel * vec4(fadeCentre, 1.0)));
+        Fade = clamp((cameraDistance - impostorFade.x) / (impostorFade.y - impostorFade.x), 0.0, 1.0);
+    }
+}
@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+#include "node_hierarchy.h"
+
+int NodeHierarchy::add(int parent, const std::string& name, const glm::vec3& translation,
+                       const glm::quat& rotation, const glm::vec3& scale) {
+    int node = static_cast<int>(size());
+    parents.push_back(parent);
+    names.push_back(name);
+    translations.push_back(translation);
+    rotations.push_back(rotation);
+    scales.push_back(scale);
+    worlds.push_back(glm::mat4(1.0f));
+    dirty.push_back(0);
+    markDirty(node);
+    return node;
+}
+
+void NodeHierarchy::clear() {
+    parents.clear();
+    names.clear();
+    translations.clear();
+    rotations.clear();
+    scales.clear();
+    worlds.clear();
+    dirty.clear();
+    firstDirty = 0;
+}
+
+int NodeHierarchy::find(const std::string& name) const {
+    auto it = std::find(names.begin(), names.end(), name);
+    return it != names.end() ? static_cast<int>(it - names.begin()) : -1;
+}
+
+void NodeHierarchy::markDirty(int node) {
+    dirty[node] = 1;
+    firstDirty = std::min(firstDirty, static_cast<size_t>(node));
+}
+
+void NodeHierarchy::setTranslation(int node, const glm::vec3& translation) {
+    translations[node] = translation;
+    markDirty(node);
+}
+
+void NodeHierarchy::setRotation(int node, const glm::quat& rotation) {
+    rotations[node] = rotation;
+    markDirty(node);
+}
+
+void NodeHierarchy::setScale(int node, const glm::vec3& scale) {
+    scales[node] = scale;
+    markDirty(node);
+}
+
+const glm::mat4& NodeHierarchy::world(int node) const {
+    static const glm::mat4 identity(1.0f);
+    return node >= 0 ? worlds[node] : identity;
+}
+
+void NodeHierarchy::update() {
+    // Parents come first, so a dirty parent has been recomputed, and has passed its flag on,
+    // by the time its children are reached
+    for (size_t i = firstDirty; i < size(); i++) {
+        int32_t parent = parents[i];
+        if (parent >= 0 && dirty[parent]) {
+            dirty[i] = 1;
+        }
+        if (!dirty[i]) {
+            continue;
+        }
+        glm::mat4 local = glm::translate(glm::mat4(1.0f), translations[i]) * glm::mat4_cast(rotations[i])
+                        * glm::scale(glm::mat4(1.0f), scales[i]);
+        worlds[i] = parent >= 0 ? worlds[parent] * local : local;
+    }
+
+    if (firstDirty < size()) {
+        std::fill(dirty.begin() + firstDirty, dirty.end(), 0);
+    }
+    firstDirty = size();
+}
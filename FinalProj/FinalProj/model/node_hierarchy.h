@@ -0,0 +1,54 @@
+#ifndef NODE_HIERARCHY_H
+#define NODE_HIERARCHY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// The glTF node tree flattened into arrays, one entry per node, with every parent stored
+// before its children. Setting a local transform marks the node dirty; update() then walks
+// the arrays once from the first dirty node and recomputes the world matrices of the dirty
+// nodes and everything below them, leaving the rest alone.
+class NodeHierarchy {
+public:
+    // Appends a node. parent must already be in the hierarchy, or -1 for a root.
+    int add(int parent, const std::string& name, const glm::vec3& translation,
+            const glm::quat& rotation, const glm::vec3& scale);
+
+    size_t size() const { return parents.size(); }
+    void clear();
+
+    // Index of the first node called name, -1 when there is none
+    int find(const std::string& name) const;
+
+    int parent(int node) const { return parents[node]; }
+    const std::string& name(int node) const { return names[node]; }
+    const glm::vec3& translation(int node) const { return translations[node]; }
+    const glm::quat& rotation(int node) const { return rotations[node]; }
+    const glm::vec3& scale(int node) const { return scales[node]; }
+
+    void setTranslation(int node, const glm::vec3& translation);
+    void setRotation(int node, const glm::quat& rotation);
+    void setScale(int node, const glm::vec3& scale);
+
+    // Node to model space, as of the last update(). The identity for node -1.
+    const glm::mat4& world(int node) const;
+
+    void update();
+
+private:
+    void markDirty(int node);
+
+    std::vector<int32_t> parents;
+    std::vector<std::string> names;
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<glm::mat4> worlds;
+    std::vector<uint8_t> dirty;
+    size_t firstDirty = 0;      // size() when nothing is dirty
+};
+
+#endif
@@ -0,0 +1,317 @@
+#include "block_compression.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+
+size_t BlockCompressedSize(int width, int height, size_t blockBytes)
+{
+	return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
+}
+
+// Copies the 4x4 block at (bx, by), repeating edge pixels past the image border
+static void FetchBlock(const uint8_t *rgba, int width, int height, int bx, int by, uint8_t block[64])
+{
+	for (int y = 0; y < 4; y++)
+	{
+		int sy = std::min(by * 4 + y, height - 1);
+		for (int x = 0; x < 4; x++)
+		{
+			int sx = std::min(bx * 4 + x, width - 1);
+			const uint8_t *pixel = rgba + (static_cast<size_t>(sy) * width + sx) * 4;
+			std::copy(pixel, pixel + 4, block + (y * 4 + x) * 4);
+		}
+	}
+}
+
+static void StoreBlock(const uint8_t block[64], int width, int height, int bx, int by, uint8_t *rgba)
+{
+	for (int y = 0; y < 4 && by * 4 + y < height; y++)
+	{
+		for (int x = 0; x < 4 && bx * 4 + x < width; x++)
+		{
+			const uint8_t *pixel = block + (y * 4 + x) * 4;
+			std::copy(pixel, pixel + 4, rgba + (static_cast<size_t>(by * 4 + y) * width + bx * 4 + x) * 4);
+		}
+	}
+}
+
+static uint16_t Pack565(const int color[3])
+{
+	return static_cast<uint16_t>(((color[0] * 31 + 127) / 255) << 11 | ((color[1] * 63 + 127) / 255) << 5 | ((color[2] * 31 + 127) / 255));
+}
+
+static void Unpack565(uint16_t packed, int color[3])
+{
+	int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+static void WriteLE(uint8_t *out, uint64_t value, int bytes)
+{
+	for (int i = 0; i < bytes; i++)
+	{
+		out[i] = static_cast<uint8_t>(value >> (8 * i));
+	}
+}
+
+static uint64_t ReadLE(const uint8_t *in, int bytes)
+{
+	uint64_t value = 0;
+	for (int i = 0; i < bytes; i++)
+	{
+		value |= static_cast<uint64_t>(in[i]) << (8 * i);
+	}
+	return value;
+}
+
+// Palette of a BC1 colour block. Four colours when c0 > c1 or forced (BC3), else three and black.
+static void ColorPalette(uint16_t c0, uint16_t c1, bool fourColors, int palette[4][4])
+{
+	Unpack565(c0, palette[0]);
+	Unpack565(c1, palette[1]);
+	palette[0][3] = palette[1][3] = 255;
+	for (int c = 0; c < 3; c++)
+	{
+		if (fourColors)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		else
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+	palette[2][3] = 255;
+	palette[3][3] = fourColors ? 255 : 0;
+}
+
+// Endpoints span the colour bounding box along the diagonal that follows the block's
+// main trend, found from the sign of the red-green and blue-green covariances
+static void EncodeColorBlock(const uint8_t block[64], uint8_t out[8])
+{
+	int lo[3] = { 255, 255, 255 }, hi[3] = { 0, 0, 0 }, mean[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			lo[c] = std::min<int>(lo[c], block[i * 4 + c]);
+			hi[c] = std::max<int>(hi[c], block[i * 4 + c]);
+			mean[c] += block[i * 4 + c];
+		}
+	}
+	int covRG = 0, covBG = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		int g = block[i * 4 + 1] * 16 - mean[1];
+		covRG += (block[i * 4 + 0] * 16 - mean[0]) / 16 * g / 16;
+		covBG += (block[i * 4 + 2] * 16 - mean[2]) / 16 * g / 16;
+	}
+
+	// Inset the box a little, extremes are rarely hit exactly
+	int end0[3], end1[3];
+	for (int c = 0; c < 3; c++)
+	{
+		int inset = (hi[c] - lo[c]) / 16;
+		end0[c] = hi[c] - inset;
+		end1[c] = lo[c] + inset;
+	}
+	if (covRG < 0) std::swap(end0[0], end1[0]);
+	if (covBG < 0) std::swap(end0[2], end1[2]);
+
+	uint16_t c0 = Pack565(end0), c1 = Pack565(end1);
+	if (c0 < c1)
+	{
+		std::swap(c0, c1);
+	}
+
+	uint32_t indices = 0;
+	if (c0 != c1)
+	{
+		int palette[4][4];
+		ColorPalette(c0, c1, true, palette);
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0, bestError = INT_MAX;
+			for (int p = 0; p < 4; p++)
+			{
+				int error = 0;
+				for (int c = 0; c < 3; c++)
+				{
+					int d = block[i * 4 + c] - palette[p][c];
+					error += d * d;
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					best = p;
+				}
+			}
+			indices |= static_cast<uint32_t>(best) << (2 * i);
+		}
+	}
+
+	WriteLE(out, c0, 2);
+	WriteLE(out + 2, c1, 2);
+	WriteLE(out + 4, indices, 4);
+}
+
+static void SingleChannelPalette(int a0, int a1, int palette[8])
+{
+	palette[0] = a0;
+	palette[1] = a1;
+	if (a0 > a1)
+	{
+		for (int i = 1; i < 7; i++)
+		{
+			palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+		}
+	}
+	else
+	{
+		for (int i = 1; i < 5; i++)
+		{
+			palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+// BC4 block of one channel of the RGBA block, always in the eight value mode
+static void EncodeChannelBlock(const uint8_t block[64], int channel, uint8_t out[8])
+{
+	int lo = 255, hi = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		lo = std::min<int>(lo, block[i * 4 + channel]);
+		hi = std::max<int>(hi, block[i * 4 + channel]);
+	}
+
+	uint64_t indices = 0;
+	if (hi > lo)
+	{
+		int palette[8];
+		SingleChannelPalette(hi, lo, palette);
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0, bestError = INT_MAX;
+			for (int p = 0; p < 8; p++)
+			{
+				int error = std::abs(block[i * 4 + channel] - palette[p]);
+				if (error < bestError)
+				{
+					bestError = error;
+					best = p;
+				}
+			}
+			indices |= static_cast<uint64_t>(best) << (3 * i);
+		}
+	}
+
+	out[0] = static_cast<uint8_t>(hi);
+	out[1] = static_cast<uint8_t>(lo);
+	WriteLE(out + 2, indices, 6);
+}
+
+template <typename EncodeBlock>
+static void CompressImage(const uint8_t *rgba, int width, int height, size_t blockBytes, uint8_t *out, EncodeBlock encode)
+{
+	uint8_t block[64];
+	int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+	for (int by = 0; by < blocksY; by++)
+	{
+		for (int bx = 0; bx < blocksX; bx++)
+		{
+			FetchBlock(rgba, width, height, bx, by, block);
+			encode(block, out + (static_cast<size_t>(by) * blocksX + bx) * blockBytes);
+		}
+	}
+}
+
+void CompressBC1(const uint8_t *rgba, int width, int height, uint8_t *out)
+{
+	CompressImage(rgba, width, height, 8, out, [](const uint8_t *block, uint8_t *dst)
+	{
+		EncodeColorBlock(block, dst);
+	});
+}
+
+void CompressBC3(const uint8_t *rgba, int width, int height, uint8_t *out)
+{
+	CompressImage(rgba, width, height, 16, out, [](const uint8_t *block, uint8_t *dst)
+	{
+		EncodeChannelBlock(block, 3, dst);
+		EncodeColorBlock(block, dst + 8);
+	});
+}
+
+void CompressBC5(const uint8_t *rgba, int width, int height, uint8_t *out)
+{
+	CompressImage(rgba, width, height, 16, out, [](const uint8_t *block, uint8_t *dst)
+	{
+		EncodeChannelBlock(block, 0, dst);
+		EncodeChannelBlock(block, 1, dst + 8);
+	});
+}
+
+static void DecodeColorBlock(const uint8_t in[8], bool forceFourColors, uint8_t block[64])
+{
+	uint16_t c0 = static_cast<uint16_t>(ReadLE(in, 2)), c1 = static_cast<uint16_t>(ReadLE(in + 2, 2));
+	uint32_t indices = static_cast<uint32_t>(ReadLE(in + 4, 4));
+	int palette[4][4];
+	ColorPalette(c0, c1, forceFourColors || c0 > c1, palette);
+	for (int i = 0; i < 16; i++)
+	{
+		const int *color = palette[(indices >> (2 * i)) & 3];
+		for (int c = 0; c < 4; c++)
+		{
+			block[i * 4 + c] = static_cast<uint8_t>(color[c]);
+		}
+	}
+}
+
+static void DecodeChannelBlock(const uint8_t in[8], int channel, uint8_t block[64])
+{
+	int palette[8];
+	SingleChannelPalette(in[0], in[1], palette);
+	uint64_t indices = ReadLE(in + 2, 6);
+	for (int i = 0; i < 16; i++)
+	{
+		block[i * 4 + channel] = static_cast<uint8_t>(palette[(indices >> (3 * i)) & 7]);
+	}
+}
+
+void DecompressBC1(const uint8_t *blocks, int width, int height, uint8_t *rgba)
+{
+	uint8_t block[64];
+	int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+	for (int by = 0; by < blocksY; by++)
+	{
+		for (int bx = 0; bx < blocksX; bx++)
+		{
+			DecodeColorBlock(blocks + (static_cast<size_t>(by) * blocksX + bx) * 8, false, block);
+			StoreBlock(block, width, height, bx, by, rgba);
+		}
+	}
+}
+
+void DecompressBC3(const uint8_t *blocks, int width, int height, uint8_t *rgba)
+{
+	uint8_t block[64];
+	int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+	for (int by = 0; by < blocksY; by++)
+	{
+		for (int bx = 0; bx < blocksX; bx++)
+		{
+			const uint8_t *in = blocks + (static_cast<size_t>(by) * blocksX + bx) * 16;
+			DecodeColorBlock(in + 8, true, block);
+			DecodeChannelBlock(in, 3, block);
+			StoreBlock(block, width, height, bx, by, rgba);
+		}
+	}
+}
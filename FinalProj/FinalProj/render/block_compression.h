@@ -0,0 +1,26 @@
+#ifndef _BLOCK_COMPRESSION_H_
+#define _BLOCK_COMPRESSION_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Encoders for the block compressed formats of the cooked textures, plus decoders for
+// the S3TC ones, which need an extension the context may lack. Every block covers 4x4
+// pixels; images with a side that is not a multiple of 4 repeat their edge pixels.
+//
+//   BC1 (S3TC DXT1)   8 bytes per block, RGB
+//   BC3 (S3TC DXT5)  16 bytes per block, RGB plus alpha
+//   BC5 (RGTC2)      16 bytes per block, two channels, used for normal maps
+
+size_t BlockCompressedSize(int width, int height, size_t blockBytes);
+
+// Compress a whole RGBA8 image into out, which holds BlockCompressedSize bytes
+void CompressBC1(const uint8_t *rgba, int width, int height, uint8_t *out);
+void CompressBC3(const uint8_t *rgba, int width, int height, uint8_t *out);
+void CompressBC5(const uint8_t *rgba, int width, int height, uint8_t *out);
+
+// Decompress into width * height * 4 bytes of RGBA8
+void DecompressBC1(const uint8_t *blocks, int width, int height, uint8_t *rgba);
+void DecompressBC3(const uint8_t *blocks, int width, int height, uint8_t *rgba);
+
+#endif
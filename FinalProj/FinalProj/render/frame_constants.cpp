@@ -0,0 +1,30 @@
+#include <cmath>
+#include "frame_constants.h"
+
+void FrameConstantsBuffer::initialize()
+{
+	glGenBuffers(1, &bufferID);
+	glBindBuffer(GL_UNIFORM_BUFFER, bufferID);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameConstants), NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_CONSTANTS_BINDING, bufferID);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void FrameConstantsBuffer::update(const FrameConstants &constants)
+{
+	// Orphan the previous contents so the driver does not wait on last frame's draws
+	glBindBuffer(GL_UNIFORM_BUFFER, bufferID);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameConstants), NULL, GL_DYNAMIC_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameConstants), &constants);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void FrameConstantsBuffer::cleanup()
+{
+	glDeleteBuffers(1, &bufferID);
+}
+
+LodView::LodView(const glm::vec3 &position, float fovY, float viewportHeight, float farDistance)
+	: position(position), pixelsPerUnit(viewportHeight / (2.0f * std::tan(fovY * 0.5f))), farDistance(farDistance)
+{
+}
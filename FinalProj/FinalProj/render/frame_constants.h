@@ -0,0 +1,50 @@
+#ifndef _FRAME_CONSTANTS_H_
+#define _FRAME_CONSTANTS_H_
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+// Uniform buffer binding point of the FrameConstants block, shared by every program
+const GLuint FRAME_CONSTANTS_BINDING = 0;
+
+// Camera and light state written once per frame. Layout matches the std140 block
+//
+//   layout(std140) uniform FrameConstants {
+//       mat4 viewProjection;
+//       mat4 lightSpaceMatrix;
+//       vec4 lightPosition;
+//       vec4 lightIntensity;
+//       vec4 viewPosition;
+//   };
+//
+// declared in the shaders, so vec3 values are padded to vec4.
+struct FrameConstants
+{
+	glm::mat4 viewProjection;
+	glm::mat4 lightSpaceMatrix;
+	glm::vec4 lightPosition;
+	glm::vec4 lightIntensity;
+	glm::vec4 viewPosition;
+};
+
+// Camera terms for choosing levels of detail on the CPU, built once per frame
+struct LodView
+{
+	glm::vec3 position;
+	float pixelsPerUnit;	// Pixels covered by one unit facing the camera at distance 1
+	float farDistance;		// Far plane of the projection
+
+	LodView(const glm::vec3 &position, float fovY, float viewportHeight, float farDistance);
+};
+
+struct FrameConstantsBuffer
+{
+	GLuint bufferID;
+
+	// Creates the buffer and attaches it to FRAME_CONSTANTS_BINDING
+	void initialize();
+	void update(const FrameConstants &constants);
+	void cleanup();
+};
+
+#endif
@@ -0,0 +1,203 @@
+#include <algorithm>
+#include "frustum_culler.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CULL_AVX 1
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define CULL_SSE 1
+#endif
+
+// Boxes a register holds at most, the arrays are padded to a multiple of it
+static const size_t CullPadding = 8;
+
+Frustum::Frustum(const glm::mat4 &viewProjection)
+{
+	// Rows of the matrix, glm stores columns. A clip-space point is inside when
+	// -w <= x, y, z <= w, and each of those six inequalities is a plane in world space.
+	glm::vec4 rows[4];
+	for (int r = 0; r < 4; r++)
+	{
+		rows[r] = glm::vec4(viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]);
+	}
+	for (int axis = 0; axis < 3; axis++)
+	{
+		planes[2 * axis] = rows[3] + rows[axis];
+		planes[2 * axis + 1] = rows[3] - rows[axis];
+	}
+}
+
+bool CullResult::contains(uint32_t box) const
+{
+	return std::binary_search(visible.begin(), visible.end(), box);
+}
+
+void CullResult::mark(const CullRange &range, std::vector<uint8_t> &flags) const
+{
+	flags.assign(range.count, 0);
+	auto it = std::lower_bound(visible.begin(), visible.end(), range.first);
+	for (; it != visible.end() && *it < range.first + range.count; ++it)
+	{
+		flags[*it - range.first] = 1;
+	}
+}
+
+CullRange FrustumCuller::add(uint32_t boxes)
+{
+	CullRange range;
+	range.first = static_cast<uint32_t>(count);
+	range.count = boxes;
+	count += boxes;
+	revisionCount++;
+
+	// New boxes and padding are empty: min above max
+	size_t padded = (count + CullPadding - 1) / CullPadding * CullPadding;
+	for (std::vector<float> *bound : { &minX, &minY, &minZ })
+	{
+		bound->resize(padded, 1.0f);
+	}
+	for (std::vector<float> *bound : { &maxX, &maxY, &maxZ })
+	{
+		bound->resize(padded, -1.0f);
+	}
+	return range;
+}
+
+void FrustumCuller::clear(const CullRange &range)
+{
+	std::fill(minX.begin() + range.first, minX.begin() + range.first + range.count, 1.0f);
+	std::fill(minY.begin() + range.first, minY.begin() + range.first + range.count, 1.0f);
+	std::fill(minZ.begin() + range.first, minZ.begin() + range.first + range.count, 1.0f);
+	std::fill(maxX.begin() + range.first, maxX.begin() + range.first + range.count, -1.0f);
+	std::fill(maxY.begin() + range.first, maxY.begin() + range.first + range.count, -1.0f);
+	std::fill(maxZ.begin() + range.first, maxZ.begin() + range.first + range.count, -1.0f);
+	revisionCount++;
+}
+
+void FrustumCuller::set(uint32_t box, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax)
+{
+	minX[box] = boundsMin.x;
+	minY[box] = boundsMin.y;
+	minZ[box] = boundsMin.z;
+	maxX[box] = boundsMax.x;
+	maxY[box] = boundsMax.y;
+	maxZ[box] = boundsMax.z;
+	revisionCount++;
+}
+
+void FrustumCuller::get(uint32_t box, glm::vec3 &boundsMin, glm::vec3 &boundsMax) const
+{
+	boundsMin = glm::vec3(minX[box], minY[box], minZ[box]);
+	boundsMax = glm::vec3(maxX[box], maxY[box], maxZ[box]);
+}
+
+void FrustumCuller::set(uint32_t box, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, const glm::mat4 &transform)
+{
+	// Centre moves with the transform, each world half-extent sums the absolute contributions
+	// of the local ones
+	glm::vec3 centre = glm::vec3(transform * glm::vec4((boundsMin + boundsMax) * 0.5f, 1.0f));
+	glm::vec3 extent = (boundsMax - boundsMin) * 0.5f;
+	glm::vec3 worldExtent(0.0f);
+	for (int column = 0; column < 3; column++)
+	{
+		worldExtent += glm::abs(glm::vec3(transform[column])) * extent[column];
+	}
+	set(box, centre - worldExtent, centre + worldExtent);
+}
+
+void FrustumCuller::cull(CullPass pass, const glm::mat4 &viewProjection)
+{
+	Frustum frustum(viewProjection);
+	CullResult &result = results[pass];
+	result.tested = count;
+
+	// For each plane, the corner farthest along its normal: max bound on axes where the normal
+	// is positive, min bound elsewhere
+	const float *cornerX[6], *cornerY[6], *cornerZ[6];
+	for (int p = 0; p < 6; p++)
+	{
+		const glm::vec4 &plane = frustum.planes[p];
+		cornerX[p] = plane.x > 0.0f ? maxX.data() : minX.data();
+		cornerY[p] = plane.y > 0.0f ? maxY.data() : minY.data();
+		cornerZ[p] = plane.z > 0.0f ? maxZ.data() : minZ.data();
+	}
+
+	// Every index is written, and the next write goes past it only when the box is visible
+	result.visible.resize(minX.size());
+	uint32_t *visible = result.visible.data();
+	size_t visibleCount = 0;
+	size_t i = 0;
+
+#if defined(CULL_AVX)
+	__m256 normalX[6], normalY[6], normalZ[6], offset[6];
+	for (int p = 0; p < 6; p++)
+	{
+		normalX[p] = _mm256_set1_ps(frustum.planes[p].x);
+		normalY[p] = _mm256_set1_ps(frustum.planes[p].y);
+		normalZ[p] = _mm256_set1_ps(frustum.planes[p].z);
+		offset[p] = _mm256_set1_ps(frustum.planes[p].w);
+	}
+	const __m256 zero = _mm256_setzero_ps();
+	for (; i < count; i += 8)
+	{
+		__m256 inside = _mm256_cmp_ps(_mm256_loadu_ps(&minX[i]), _mm256_loadu_ps(&maxX[i]), _CMP_LE_OQ);
+		for (int p = 0; p < 6; p++)
+		{
+			__m256 distance = _mm256_add_ps(_mm256_mul_ps(normalX[p], _mm256_loadu_ps(cornerX[p] + i)), offset[p]);
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(normalY[p], _mm256_loadu_ps(cornerY[p] + i)));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(normalZ[p], _mm256_loadu_ps(cornerZ[p] + i)));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, zero, _CMP_GE_OQ));
+		}
+		int mask = _mm256_movemask_ps(inside);
+		for (int lane = 0; lane < 8; lane++)
+		{
+			visible[visibleCount] = static_cast<uint32_t>(i + lane);
+			visibleCount += (mask >> lane) & 1;
+		}
+	}
+#elif defined(CULL_SSE)
+	__m128 normalX[6], normalY[6], normalZ[6], offset[6];
+	for (int p = 0; p < 6; p++)
+	{
+		normalX[p] = _mm_set1_ps(frustum.planes[p].x);
+		normalY[p] = _mm_set1_ps(frustum.planes[p].y);
+		normalZ[p] = _mm_set1_ps(frustum.planes[p].z);
+		offset[p] = _mm_set1_ps(frustum.planes[p].w);
+	}
+	const __m128 zero = _mm_setzero_ps();
+	for (; i < count; i += 4)
+	{
+		__m128 inside = _mm_cmple_ps(_mm_loadu_ps(&minX[i]), _mm_loadu_ps(&maxX[i]));
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(_mm_mul_ps(normalX[p], _mm_loadu_ps(cornerX[p] + i)), offset[p]);
+			distance = _mm_add_ps(distance, _mm_mul_ps(normalY[p], _mm_loadu_ps(cornerY[p] + i)));
+			distance = _mm_add_ps(distance, _mm_mul_ps(normalZ[p], _mm_loadu_ps(cornerZ[p] + i)));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+		}
+		int mask = _mm_movemask_ps(inside);
+		for (int lane = 0; lane < 4; lane++)
+		{
+			visible[visibleCount] = static_cast<uint32_t>(i + lane);
+			visibleCount += (mask >> lane) & 1;
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		bool inside = minX[i] <= maxX[i];
+		for (int p = 0; p < 6 && inside; p++)
+		{
+			const glm::vec4 &plane = frustum.planes[p];
+			inside = plane.x * cornerX[p][i] + plane.w + plane.y * cornerY[p][i] + plane.z * cornerZ[p][i] >= 0.0f;
+		}
+		visible[visibleCount] = static_cast<uint32_t>(i);
+		visibleCount += inside ? 1 : 0;
+	}
+
+	result.visible.resize(visibleCount);
+	result.culled = count - visibleCount;
+	result.occluded = 0;
+}
@@ -0,0 +1,91 @@
+#ifndef _FRUSTUM_CULLER_H_
+#define _FRUSTUM_CULLER_H_
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// The six planes of a view-projection matrix, normals pointing inwards. A point p is inside
+// when dot(plane.xyz, p) + plane.w >= 0 for every plane. The planes are not normalised, which
+// is all a sign test needs.
+struct Frustum
+{
+	glm::vec4 planes[6];
+
+	explicit Frustum(const glm::mat4 &viewProjection);
+};
+
+// Passes each frame culls for, in the order they are drawn
+enum CullPass
+{
+	CULL_PASS_SHADOW,
+	CULL_PASS_CAMERA,
+	CULL_PASS_COUNT
+};
+
+// Boxes of one owner, allocated together
+struct CullRange
+{
+	uint32_t first = 0;
+	uint32_t count = 0;
+};
+
+// Outcome of culling every box against one pass
+struct CullResult
+{
+	std::vector<uint32_t> visible;	// Indices of the boxes in view, ascending
+	size_t tested = 0;
+	size_t culled = 0;
+	size_t occluded = 0;			// Of culled, those hidden behind others rather than out of view
+
+	bool contains(uint32_t box) const;
+
+	// Resizes flags to range.count and sets flags[i] to whether box range.first + i is visible
+	void mark(const CullRange &range, std::vector<uint8_t> &flags) const;
+};
+
+// World-space bounding boxes of the scene, kept as structure of arrays so that cull() tests
+// a whole register of boxes per plane: 8 at a time when compiled for AVX, 4 with SSE, and
+// one by one elsewhere. A box is outside a plane when the corner farthest along the plane
+// normal is behind it, and culled when outside any of the six.
+//
+// Owners allocate their boxes once with add() and rewrite them with set() whenever they
+// move, before the frame's passes are culled.
+class FrustumCuller
+{
+public:
+	// Appends count boxes, empty, and so never visible, until set
+	CullRange add(uint32_t count);
+
+	void set(uint32_t box, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax);
+
+	// Box around the local box boundsMin, boundsMax once transformed
+	void set(uint32_t box, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, const glm::mat4 &transform);
+
+	void get(uint32_t box, glm::vec3 &boundsMin, glm::vec3 &boundsMax) const;
+
+	// Empties every box of range, for owners that moved to a new range and leave this one behind
+	void clear(const CullRange &range);
+
+	size_t size() const { return count; }
+
+	// Changes whenever a box is added or set
+	uint64_t revision() const { return revisionCount; }
+
+	// Tests every box against the frustum of viewProjection, replacing the result of pass
+	void cull(CullPass pass, const glm::mat4 &viewProjection);
+
+	const CullResult &result(CullPass pass) const { return results[pass]; }
+
+	// For later stages, such as occlusion culling, that narrow the result down in place
+	CullResult &result(CullPass pass) { return results[pass]; }
+
+private:
+	// Padded with empty boxes to a whole number of registers
+	std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+	size_t count = 0;
+	uint64_t revisionCount = 0;
+	CullResult results[CULL_PASS_COUNT];
+};
+
+#endif
@@ -0,0 +1,55 @@
+#include "gl_extensions.h"
+
+#include <cstring>
+
+GLExtensions glExtensions;
+
+bool HasGLExtension(const char *name)
+{
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; i++)
+	{
+		const char *extension = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+		if (extension && strcmp(extension, name) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+template <typename T>
+static bool LoadEntryPoint(GLADloadfunc load, T &pointer, const char *name)
+{
+	pointer = reinterpret_cast<T>(load(name));
+	return pointer != nullptr;
+}
+
+void LoadGLExtensions(GLADloadfunc load)
+{
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	int version = major * 10 + minor;
+
+	// Program binaries, core since 4.1
+	if (version >= 41 || HasGLExtension("GL_ARB_get_program_binary"))
+	{
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		glExtensions.programBinary = formats > 0
+			&& LoadEntryPoint(load, glExtensions.GetProgramBinary, "glGetProgramBinary")
+			&& LoadEntryPoint(load, glExtensions.ProgramBinary, "glProgramBinary")
+			&& LoadEntryPoint(load, glExtensions.ProgramParameteri, "glProgramParameteri");
+	}
+
+	// Immutable, persistently mappable buffers, core since 4.4
+	if (version >= 44 || HasGLExtension("GL_ARB_buffer_storage"))
+	{
+		glExtensions.bufferStorage = LoadEntryPoint(load, glExtensions.BufferStorage, "glBufferStorage");
+	}
+
+	// BC1-3 textures. Never core, but all desktop drivers have it; RGTC is core since 3.0
+	glExtensions.textureCompressionS3TC = HasGLExtension("GL_EXT_texture_compression_s3tc");
+}
@@ -0,0 +1,44 @@
+#ifndef _GL_EXTENSIONS_H_
+#define _GL_EXTENSIONS_H_
+
+#include <glad/gl.h>
+
+// glad is generated for the plain GL 3.3 core profile, so optional extensions
+// are detected and loaded here. Entry points stay null when unsupported.
+
+// ARB_get_program_binary
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH           0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS      0x87FE
+
+// ARB_buffer_storage
+#define GL_MAP_PERSISTENT_BIT              0x0040
+#define GL_MAP_COHERENT_BIT                0x0080
+#define GL_DYNAMIC_STORAGE_BIT             0x0100
+#define GL_CLIENT_STORAGE_BIT              0x0200
+
+// EXT_texture_compression_s3tc
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT    0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT   0x83F3
+
+struct GLExtensions
+{
+	bool programBinary = false;
+	void (GLAD_API_PTR *GetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary) = nullptr;
+	void (GLAD_API_PTR *ProgramBinary)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length) = nullptr;
+	void (GLAD_API_PTR *ProgramParameteri)(GLuint program, GLenum pname, GLint value) = nullptr;
+
+	bool bufferStorage = false;
+	void (GLAD_API_PTR *BufferStorage)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags) = nullptr;
+
+	bool textureCompressionS3TC = false;
+};
+
+extern GLExtensions glExtensions;
+
+bool HasGLExtension(const char *name);
+
+// Call once after gladLoadGL, with the same loader
+void LoadGLExtensions(GLADloadfunc load);
+
+#endif
@@ -0,0 +1,349 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <future>
+#include <asset/thread_pool.h>
+#include "occlusion_culler.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define OCCLUSION_SSE 1
+#endif
+
+// Allowance for rounding in the interpolated depth, so that no occluder hides itself
+static const float OcclusionDepthBias = 1e-6f;
+
+// Pixels along each side of a tile
+static const int OcclusionTileSize = 8;
+
+// Occluders rasterised each frame, the ones covering most of the screen
+static const size_t OcclusionMaxOccluders = 32;
+
+// Corners of each face of a box, in order around it. Corner c has the max bound on x when
+// bit 0 is set, on y for bit 1 and on z for bit 2. Faces go -x, +x, -y, +y, -z, +z.
+static const int BoxFaces[6][4] = {
+	{ 0, 2, 6, 4 }, { 1, 3, 7, 5 },
+	{ 0, 1, 5, 4 }, { 2, 3, 7, 6 },
+	{ 0, 1, 3, 2 }, { 4, 5, 7, 6 }
+};
+
+static glm::vec3 BoxCorner(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, int corner)
+{
+	return glm::vec3(corner & 1 ? boundsMax.x : boundsMin.x,
+					 corner & 2 ? boundsMax.y : boundsMin.y,
+					 corner & 4 ? boundsMax.z : boundsMin.z);
+}
+
+void OcclusionCuller::initialize(int width, int height)
+{
+	tilesX = std::max(1, (width + OcclusionTileSize - 1) / OcclusionTileSize);
+	tilesY = std::max(1, (height + OcclusionTileSize - 1) / OcclusionTileSize);
+	this->width = tilesX * OcclusionTileSize;
+	this->height = tilesY * OcclusionTileSize;
+	depth.assign(static_cast<size_t>(this->width) * this->height, FLT_MAX);
+	tileMax.assign(static_cast<size_t>(tilesX) * tilesY, FLT_MAX);
+}
+
+void OcclusionCuller::addOccluders(const CullRange &range)
+{
+	occluders.push_back(range);
+}
+
+void OcclusionCuller::clearOccluders()
+{
+	occluders.clear();
+}
+
+void OcclusionCuller::cull(FrustumCuller &culler, const glm::mat4 &viewProjection, const glm::vec3 &eye)
+{
+	CullResult &result = culler.result(CULL_PASS_CAMERA);
+	result.occluded = 0;
+	if (depth.empty()) return;
+
+	// Occluders in view, by how much of the screen they may cover, camera not inside them
+	candidates.clear();
+	for (const CullRange &range : occluders)
+	{
+		result.mark(range, inView);
+		for (uint32_t i = 0; i < range.count; i++)
+		{
+			if (!inView[i]) continue;
+			glm::vec3 boundsMin, boundsMax;
+			culler.get(range.first + i, boundsMin, boundsMax);
+			if (glm::all(glm::greaterThanEqual(eye, boundsMin)) && glm::all(glm::lessThanEqual(eye, boundsMax)))
+			{
+				continue;
+			}
+			glm::vec3 extent = boundsMax - boundsMin;
+			glm::vec3 offset = (boundsMin + boundsMax) * 0.5f - eye;
+			candidates.push_back(std::make_pair(glm::dot(extent, extent) / glm::dot(offset, offset), range.first + i));
+		}
+	}
+	size_t occluderCount = std::min(candidates.size(), OcclusionMaxOccluders);
+	std::partial_sort(candidates.begin(), candidates.begin() + occluderCount, candidates.end(),
+					  [](const std::pair<float, uint32_t> &a, const std::pair<float, uint32_t> &b) { return a.first > b.first; });
+
+	triangles.clear();
+	for (size_t i = 0; i < occluderCount; i++)
+	{
+		glm::vec3 boundsMin, boundsMax;
+		culler.get(candidates[i].second, boundsMin, boundsMax);
+		addFaces(boundsMin, boundsMax, eye, viewProjection);
+	}
+	if (triangles.empty()) return;
+
+	// One band of tile rows per worker, and the last one on this thread. Bands cover
+	// separate rows of the buffers, so they need no locking.
+	ThreadPool &pool = ThreadPool::shared();
+	int bands = std::min(tilesY, static_cast<int>(pool.size()) + 1);
+	std::vector<std::future<void>> jobs;
+	for (int band = 0; band + 1 < bands; band++)
+	{
+		int first = band * tilesY / bands, end = (band + 1) * tilesY / bands;
+		jobs.push_back(pool.submit([this, first, end]() { rasterise(first, end); }));
+	}
+	rasterise((bands - 1) * tilesY / bands, tilesY);
+	for (std::future<void> &job : jobs)
+	{
+		job.get();
+	}
+
+	// Keep the boxes some part of which may be seen
+	size_t kept = 0;
+	for (uint32_t box : result.visible)
+	{
+		glm::vec3 boundsMin, boundsMax;
+		culler.get(box, boundsMin, boundsMax);
+		if (isVisible(boundsMin, boundsMax, viewProjection))
+		{
+			result.visible[kept++] = box;
+		}
+	}
+	result.occluded = result.visible.size() - kept;
+	result.culled += result.occluded;
+	result.visible.resize(kept);
+}
+
+void OcclusionCuller::addFaces(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, const glm::vec3 &eye,
+							   const glm::mat4 &viewProjection)
+{
+	glm::vec4 clip[8];
+	for (int corner = 0; corner < 8; corner++)
+	{
+		clip[corner] = viewProjection * glm::vec4(BoxCorner(boundsMin, boundsMax, corner), 1.0f);
+	}
+
+	for (int face = 0; face < 6; face++)
+	{
+		// Only the faces looking towards the camera, the others are behind them
+		int axis = face / 2;
+		bool facing = face % 2 ? eye[axis] > boundsMax[axis] : eye[axis] < boundsMin[axis];
+		if (!facing) continue;
+
+		// Cut away what lies in front of the near plane, z >= -w, leaving at most 5 corners
+		glm::vec4 polygon[5];
+		int count = 0;
+		for (int k = 0; k < 4; k++)
+		{
+			const glm::vec4 &from = clip[BoxFaces[face][k]], &to = clip[BoxFaces[face][(k + 1) % 4]];
+			float fromDistance = from.z + from.w, toDistance = to.z + to.w;
+			if (fromDistance >= 0.0f)
+			{
+				polygon[count++] = from;
+			}
+			if ((fromDistance >= 0.0f) != (toDistance >= 0.0f))
+			{
+				polygon[count++] = from + (to - from) * (fromDistance / (fromDistance - toDistance));
+			}
+		}
+		addPolygon(polygon, count);
+	}
+}
+
+void OcclusionCuller::addPolygon(const glm::vec4 *clip, int count)
+{
+	glm::vec3 screen[5];
+	for (int k = 0; k < count; k++)
+	{
+		glm::vec3 ndc = glm::vec3(clip[k]) / clip[k].w;
+		screen[k] = glm::vec3((ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height, ndc.z);
+	}
+
+	for (int k = 1; k + 1 < count; k++)
+	{
+		Triangle triangle;
+		triangle.corners[0] = screen[0];
+		triangle.corners[1] = screen[k];
+		triangle.corners[2] = screen[k + 1];
+
+		// Counter-clockwise, so that edge functions are positive inside
+		const glm::vec3 &a = triangle.corners[0], &b = triangle.corners[1], &c = triangle.corners[2];
+		float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+		if (area == 0.0f) continue;
+		if (area < 0.0f)
+		{
+			std::swap(triangle.corners[1], triangle.corners[2]);
+		}
+
+		// Pixels whose centres may be inside
+		glm::vec2 low = glm::min(glm::vec2(a), glm::min(glm::vec2(b), glm::vec2(c)));
+		glm::vec2 high = glm::max(glm::vec2(a), glm::max(glm::vec2(b), glm::vec2(c)));
+		triangle.minX = std::max(0, static_cast<int>(std::ceil(low.x - 0.5f)));
+		triangle.minY = std::max(0, static_cast<int>(std::ceil(low.y - 0.5f)));
+		triangle.maxX = std::min(width - 1, static_cast<int>(std::floor(high.x - 0.5f)));
+		triangle.maxY = std::min(height - 1, static_cast<int>(std::floor(high.y - 0.5f)));
+		if (triangle.minX <= triangle.maxX && triangle.minY <= triangle.maxY)
+		{
+			triangles.push_back(triangle);
+		}
+	}
+}
+
+void OcclusionCuller::rasterise(int firstTileRow, int endTileRow)
+{
+	int firstRow = firstTileRow * OcclusionTileSize, endRow = endTileRow * OcclusionTileSize;
+	std::fill(depth.begin() + static_cast<size_t>(firstRow) * width, depth.begin() + static_cast<size_t>(endRow) * width, FLT_MAX);
+
+	for (const Triangle &triangle : triangles)
+	{
+		int minY = std::max(triangle.minY, firstRow), maxY = std::min(triangle.maxY, endRow - 1);
+		if (minY > maxY) continue;
+
+		// Edge function of each side, A x + B y + C, is positive on the side of the opposite
+		// corner and is that corner's barycentric weight once divided by the area
+		const glm::vec3 *corners = triangle.corners;
+		float edgeA[3], edgeB[3], edgeC[3];
+		for (int k = 0; k < 3; k++)
+		{
+			const glm::vec3 &from = corners[(k + 1) % 3], &to = corners[(k + 2) % 3];
+			edgeA[k] = from.y - to.y;
+			edgeB[k] = to.x - from.x;
+			edgeC[k] = from.x * to.y - from.y * to.x;
+		}
+		float area = edgeC[0] + edgeC[1] + edgeC[2];
+		float depthA = (edgeA[0] * corners[0].z + edgeA[1] * corners[1].z + edgeA[2] * corners[2].z) / area;
+		float depthB = (edgeB[0] * corners[0].z + edgeB[1] * corners[1].z + edgeB[2] * corners[2].z) / area;
+		float depthC = (edgeC[0] * corners[0].z + edgeC[1] * corners[1].z + edgeC[2] * corners[2].z) / area;
+
+		for (int y = minY; y <= maxY; y++)
+		{
+			float centreY = y + 0.5f;
+			float *row = &depth[static_cast<size_t>(y) * width];
+			int x = triangle.minX;
+#if defined(OCCLUSION_SSE)
+			// Rows are whole tiles wide, so 4 pixels from a multiple of 4 never run past the end
+			const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+			__m128 rowEdge[3];
+			for (int k = 0; k < 3; k++)
+			{
+				rowEdge[k] = _mm_set1_ps(edgeB[k] * centreY + edgeC[k]);
+			}
+			__m128 rowDepth = _mm_set1_ps(depthB * centreY + depthC);
+			const __m128 zero = _mm_setzero_ps();
+			for (x &= ~3; x <= triangle.maxX; x += 4)
+			{
+				__m128 centreX = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffsets);
+				__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[0]), centreX), rowEdge[0]), zero);
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[1]), centreX), rowEdge[1]), zero));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[2]), centreX), rowEdge[2]), zero));
+				if (_mm_movemask_ps(inside) == 0) continue;
+
+				// Nearer depth where the mask is set, the old one elsewhere
+				__m128 pixelDepth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(depthA), centreX), rowDepth);
+				__m128 old = _mm_loadu_ps(row + x);
+				__m128 nearer = _mm_min_ps(old, pixelDepth);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+			}
+#else
+			for (; x <= triangle.maxX; x++)
+			{
+				float centreX = x + 0.5f;
+				bool inside = true;
+				for (int k = 0; k < 3; k++)
+				{
+					inside = inside && edgeA[k] * centreX + edgeB[k] * centreY + edgeC[k] >= 0.0f;
+				}
+				if (inside)
+				{
+					row[x] = std::min(row[x], depthA * centreX + depthB * centreY + depthC);
+				}
+			}
+#endif
+		}
+	}
+
+	// Farthest depth of each tile of the band
+	for (int tileY = firstTileRow; tileY < endTileRow; tileY++)
+	{
+		for (int tileX = 0; tileX < tilesX; tileX++)
+		{
+			float farthest = 0.0f;
+			for (int y = tileY * OcclusionTileSize; y < (tileY + 1) * OcclusionTileSize; y++)
+			{
+				const float *row = &depth[static_cast<size_t>(y) * width + tileX * OcclusionTileSize];
+				farthest = std::max(farthest, *std::max_element(row, row + OcclusionTileSize));
+			}
+			tileMax[static_cast<size_t>(tileY) * tilesX + tileX] = farthest;
+		}
+	}
+}
+
+bool OcclusionCuller::isVisible(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, const glm::mat4 &viewProjection) const
+{
+	// Screen rectangle and nearest depth of the box. Boxes reaching past the near plane
+	// are too close to be hidden.
+	glm::vec2 low(FLT_MAX), high(-FLT_MAX);
+	float nearest = FLT_MAX;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		glm::vec4 clip = viewProjection * glm::vec4(BoxCorner(boundsMin, boundsMax, corner), 1.0f);
+		if (clip.z + clip.w <= 0.0f || clip.w <= 0.0f)
+		{
+			return true;
+		}
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		glm::vec2 screen((ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height);
+		low = glm::min(low, screen);
+		high = glm::max(high, screen);
+		nearest = std::min(nearest, ndc.z);
+	}
+	nearest -= OcclusionDepthBias;
+
+	// Every pixel the rectangle touches. Off screen is for the frustum test to decide.
+	int minX = std::max(0, static_cast<int>(std::floor(low.x)));
+	int minY = std::max(0, static_cast<int>(std::floor(low.y)));
+	int maxX = std::min(width - 1, static_cast<int>(std::floor(high.x)));
+	int maxY = std::min(height - 1, static_cast<int>(std::floor(high.y)));
+	if (minX > maxX || minY > maxY)
+	{
+		return true;
+	}
+
+	for (int tileY = minY / OcclusionTileSize; tileY <= maxY / OcclusionTileSize; tileY++)
+	{
+		for (int tileX = minX / OcclusionTileSize; tileX <= maxX / OcclusionTileSize; tileX++)
+		{
+			// Hidden here when everything drawn in the tile is nearer
+			if (tileMax[static_cast<size_t>(tileY) * tilesX + tileX] < nearest) continue;
+
+			int x0 = std::max(minX, tileX * OcclusionTileSize), x1 = std::min(maxX, (tileX + 1) * OcclusionTileSize - 1);
+			int y0 = std::max(minY, tileY * OcclusionTileSize), y1 = std::min(maxY, (tileY + 1) * OcclusionTileSize - 1);
+			if (x1 - x0 + 1 == OcclusionTileSize && y1 - y0 + 1 == OcclusionTileSize)
+			{
+				return true;
+			}
+			for (int y = y0; y <= y1; y++)
+			{
+				const float *row = &depth[static_cast<size_t>(y) * width];
+				for (int x = x0; x <= x1; x++)
+				{
+					if (row[x] >= nearest)
+					{
+						return true;
+					}
+				}
+			}
+		}
+	}
+	return false;
+}
@@ -0,0 +1,56 @@
+#ifndef _OCCLUSION_CULLER_H_
+#define _OCCLUSION_CULLER_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+#include "frustum_culler.h"
+
+// Software occlusion culling for the camera pass, entirely on the CPU so nothing waits on
+// the GPU and it works the same on a software GL driver.
+//
+// Each frame the largest solid boxes in view, the buildings, have their faces that look
+// towards the camera rasterised into a small depth buffer, 4 pixels at a time with SSE and
+// with one band of tile rows per worker of the shared ThreadPool. Every tile of 8x8 pixels
+// then keeps the farthest depth in it, and a box is hidden when its nearest corner is behind
+// that depth over every tile its screen rectangle touches, or behind every pixel of the
+// rectangle in tiles it only partly covers.
+class OcclusionCuller
+{
+public:
+	// Depth buffer size in pixels, rounded up to whole tiles
+	void initialize(int width, int height);
+
+	// Boxes of culler that are solid, so that whatever is behind them is hidden
+	void addOccluders(const CullRange &range);
+	void clearOccluders();
+
+	// Rasterises the largest occluders the camera pass of culler sees from viewProjection,
+	// then removes the boxes they hide from that pass
+	void cull(FrustumCuller &culler, const glm::mat4 &viewProjection, const glm::vec3 &eye);
+
+private:
+	// Screen position in pixels and depth of each corner, and the pixels around them
+	struct Triangle
+	{
+		glm::vec3 corners[3];
+		int minX, minY, maxX, maxY;
+	};
+
+	void addFaces(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, const glm::vec3 &eye,
+				  const glm::mat4 &viewProjection);
+	void addPolygon(const glm::vec4 *clip, int count);
+	void rasterise(int firstTileRow, int endTileRow);
+	bool isVisible(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, const glm::mat4 &viewProjection) const;
+
+	int width = 0, height = 0, tilesX = 0, tilesY = 0;
+	std::vector<float> depth;		// Row by row from the bottom, NDC depth, FLT_MAX where empty
+	std::vector<float> tileMax;		// Farthest depth in each tile
+	std::vector<CullRange> occluders;
+	std::vector<Triangle> triangles;
+	std::vector<uint8_t> inView;
+	std::vector<std::pair<float, uint32_t>> candidates;
+};
+
+#endif
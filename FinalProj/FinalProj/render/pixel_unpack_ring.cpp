@@ -0,0 +1,154 @@
+#include "pixel_unpack_ring.h"
+#include "gl_extensions.h"
+
+#include <memory>
+
+// Enough for a 2k RGBA8 texture with room to spare, larger uploads grow the ring
+static const GLsizeiptr DEFAULT_RING_CAPACITY = 32 * 1024 * 1024;
+
+// Keeps every region on a cache line, far above the 4-byte alignment RGBA8 rows need
+static const GLsizeiptr REGION_ALIGNMENT = 64;
+
+static thread_local std::unique_ptr<PixelUnpackRing> threadRing;
+
+PixelUnpackRing::PixelUnpackRing(GLsizeiptr capacity)
+{
+	create(capacity);
+}
+
+PixelUnpackRing::~PixelUnpackRing()
+{
+	destroy();
+}
+
+PixelUnpackRing &PixelUnpackRing::current()
+{
+	if (!threadRing)
+	{
+		threadRing.reset(new PixelUnpackRing(DEFAULT_RING_CAPACITY));
+	}
+	return *threadRing;
+}
+
+void PixelUnpackRing::releaseCurrent()
+{
+	threadRing.reset();
+}
+
+void PixelUnpackRing::create(GLsizeiptr size)
+{
+	capacity = size;
+	head = 0;
+	persistent = glExtensions.bufferStorage;
+
+	glGenBuffers(1, &bufferID);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, bufferID);
+	if (persistent)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glExtensions.BufferStorage(GL_PIXEL_UNPACK_BUFFER, capacity, nullptr, flags);
+		mapped = static_cast<unsigned char *>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, capacity, flags));
+	}
+	else
+	{
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void PixelUnpackRing::destroy()
+{
+	if (bufferID == 0)
+	{
+		return;
+	}
+
+	waitForLap();
+	if (mapped)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, bufferID);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		mapped = nullptr;
+	}
+	glDeleteBuffers(1, &bufferID);
+	bufferID = 0;
+}
+
+void PixelUnpackRing::waitForLap()
+{
+	// Fences signal in submission order, so the last one covers the whole lap
+	if (!lapFences.empty())
+	{
+		GLsync last = lapFences.back();
+		while (glClientWaitSync(last, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+		{
+		}
+	}
+	for (GLsync fence : lapFences)
+	{
+		glDeleteSync(fence);
+	}
+	lapFences.clear();
+}
+
+PixelUnpackRing::Region PixelUnpackRing::allocate(GLsizeiptr size)
+{
+	GLsizeiptr alignedSize = (size + REGION_ALIGNMENT - 1) / REGION_ALIGNMENT * REGION_ALIGNMENT;
+
+	if (alignedSize > capacity)
+	{
+		// Immutable storage cannot be resized, both paths simply start over with a bigger buffer
+		destroy();
+		create(alignedSize);
+	}
+	else if (head + alignedSize > capacity)
+	{
+		// Wrap. The previous lap must be consumed before it is overwritten, or be orphaned.
+		if (persistent)
+		{
+			waitForLap();
+		}
+		else
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, bufferID);
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+		}
+		head = 0;
+	}
+
+	Region region;
+	region.offset = head;
+	region.size = size;
+	head += alignedSize;
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, bufferID);
+	if (persistent)
+	{
+		region.data = mapped ? mapped + region.offset : nullptr;
+	}
+	else
+	{
+		GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+		region.data = static_cast<unsigned char *>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, region.offset, size, access));
+	}
+	return region;
+}
+
+void PixelUnpackRing::unmap(const Region &region)
+{
+	// Coherent persistent memory needs no unmap or flush
+	if (!persistent && region.data)
+	{
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	}
+}
+
+void PixelUnpackRing::retire(const Region &region)
+{
+	if (persistent && region.data)
+	{
+		lapFences.push_back(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
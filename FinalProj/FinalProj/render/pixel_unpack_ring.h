@@ -0,0 +1,62 @@
+#ifndef _PIXEL_UNPACK_RING_H_
+#define _PIXEL_UNPACK_RING_H_
+
+#include <glad/gl.h>
+#include <vector>
+
+// Staging memory for texture uploads: one GL_PIXEL_UNPACK_BUFFER used as a ring.
+// Pixels are written straight into mapped buffer memory and the texture is filled from
+// a buffer offset, so the driver does not have to copy them out of client memory before
+// glTexImage returns.
+//
+// With ARB_buffer_storage the buffer is mapped once, persistently and coherently, and a
+// lap of the ring is only reused after the fences of its uploads have signalled. On plain
+// GL 3.3 the buffer is orphaned whenever the ring wraps and each region is mapped
+// unsynchronized, which is safe because it has never been used in the current storage.
+//
+// A ring belongs to one context: use current() from the thread that issues the uploads.
+class PixelUnpackRing
+{
+public:
+	struct Region
+	{
+		unsigned char *data = nullptr;	// Mapped memory to write the pixels into
+		GLintptr offset = 0;			// Pass as the pixel pointer while the buffer is bound
+		GLsizeiptr size = 0;
+	};
+
+	explicit PixelUnpackRing(GLsizeiptr capacity);
+	~PixelUnpackRing();
+	PixelUnpackRing(const PixelUnpackRing &) = delete;
+	PixelUnpackRing &operator=(const PixelUnpackRing &) = delete;
+
+	// Reserves size bytes and leaves the buffer bound to GL_PIXEL_UNPACK_BUFFER.
+	// The ring grows when size exceeds its capacity.
+	Region allocate(GLsizeiptr size);
+
+	// Call once the pixels are written and before the texture call reading region.
+	void unmap(const Region &region);
+
+	// Call after the texture calls reading region have been issued. Unbinds the buffer.
+	void retire(const Region &region);
+
+	// Ring of the calling thread, created on first use
+	static PixelUnpackRing &current();
+
+	// Frees the calling thread's ring while its context is still current
+	static void releaseCurrent();
+
+private:
+	void create(GLsizeiptr capacity);
+	void destroy();
+	void waitForLap();
+
+	GLuint bufferID = 0;
+	GLsizeiptr capacity = 0;
+	GLintptr head = 0;
+	bool persistent = false;
+	unsigned char *mapped = nullptr;	// Whole buffer, persistent path only
+	std::vector<GLsync> lapFences;		// Uploads of the current lap, persistent path only
+};
+
+#endif
@@ -0,0 +1,466 @@
+#include <algorithm>
+#include <cfloat>
+#include <mutex>
+#include "scene_bvh.h"
+
+// Bins the centres are sorted into along each axis when looking for a split
+static const int BvhBins = 16;
+
+// Nodes this small become leaves when splitting them does not pay off
+static const uint32_t BvhMaxLeafSize = 4;
+
+// Cost of visiting a node, relative to testing one box
+static const float BvhTraversalCost = 1.0f;
+
+// Deeper nodes are leaves whatever their size, so a traversal stack of BvhStackSize holds
+// every node pending on the way down
+static const int BvhMaxDepth = 48;
+static const int BvhStackSize = 64;
+
+enum Containment
+{
+	OUTSIDE,
+	INTERSECTING,
+	INSIDE
+};
+
+static float SurfaceArea(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax)
+{
+	glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(0.0f));
+	return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+static Containment Classify(const Frustum &frustum, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax)
+{
+	// Outside when the corner farthest along a normal is behind its plane, inside when even
+	// the nearest corner is in front of all of them
+	Containment containment = INSIDE;
+	for (const glm::vec4 &plane : frustum.planes)
+	{
+		glm::vec3 normal(plane);
+		glm::vec3 farCorner(normal.x > 0.0f ? boundsMax.x : boundsMin.x,
+							normal.y > 0.0f ? boundsMax.y : boundsMin.y,
+							normal.z > 0.0f ? boundsMax.z : boundsMin.z);
+		if (glm::dot(normal, farCorner) + plane.w < 0.0f)
+		{
+			return OUTSIDE;
+		}
+		glm::vec3 nearCorner = boundsMin + boundsMax - farCorner;
+		if (glm::dot(normal, nearCorner) + plane.w < 0.0f)
+		{
+			containment = INTERSECTING;
+		}
+	}
+	return containment;
+}
+
+static bool Overlaps(const glm::vec3 &centre, float radius, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax)
+{
+	glm::vec3 offset = centre - glm::clamp(centre, boundsMin, boundsMax);
+	return glm::dot(offset, offset) <= radius * radius;
+}
+
+static bool Overlaps(const glm::vec3 &aMin, const glm::vec3 &aMax, const glm::vec3 &bMin, const glm::vec3 &bMax)
+{
+	return aMin.x <= bMax.x && aMin.y <= bMax.y && aMin.z <= bMax.z
+		&& bMin.x <= aMax.x && bMin.y <= aMax.y && bMin.z <= aMax.z;
+}
+
+// Distance along the ray at which it enters the box, or a negative value when it misses it
+// or only reaches it beyond maxDistance
+static float Enter(const glm::vec3 &origin, const glm::vec3 &inverseDirection, float maxDistance,
+				   const glm::vec3 &boundsMin, const glm::vec3 &boundsMax)
+{
+	glm::vec3 t0 = (boundsMin - origin) * inverseDirection;
+	glm::vec3 t1 = (boundsMax - origin) * inverseDirection;
+	glm::vec3 nearT = glm::min(t0, t1), farT = glm::max(t0, t1);
+	float enter = std::max(std::max(nearT.x, nearT.y), std::max(nearT.z, 0.0f));
+	float exit = std::min(std::min(farT.x, farT.y), std::min(farT.z, maxDistance));
+	return enter <= exit ? enter : -1.0f;
+}
+
+struct SceneBvh::Builder
+{
+	SceneBvh &bvh;
+	std::vector<uint32_t> order;	// Slots of the boxes, partitioned in place as nodes split
+	std::vector<glm::vec3> boundsMin, boundsMax, centres;	// By slot
+
+	explicit Builder(SceneBvh &bvh) : bvh(bvh) {}
+
+	void buildNode(uint32_t first, uint32_t count, int depth);
+};
+
+void SceneBvh::Builder::buildNode(uint32_t first, uint32_t count, int depth)
+{
+	uint32_t index = static_cast<uint32_t>(bvh.nodes.size());
+	bvh.nodes.push_back(Node());
+
+	// Bounds of the boxes, empty ones left out, and of their centres
+	Node node;
+	node.first = first;
+	node.count = count;
+	node.right = 0;
+	node.boundsMin = glm::vec3(FLT_MAX);
+	node.boundsMax = glm::vec3(-FLT_MAX);
+	glm::vec3 centreMin(FLT_MAX), centreMax(-FLT_MAX);
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		uint32_t slot = order[i];
+		if (boundsMin[slot].x <= boundsMax[slot].x)
+		{
+			node.boundsMin = glm::min(node.boundsMin, boundsMin[slot]);
+			node.boundsMax = glm::max(node.boundsMax, boundsMax[slot]);
+		}
+		centreMin = glm::min(centreMin, centres[slot]);
+		centreMax = glm::max(centreMax, centres[slot]);
+	}
+	bvh.nodes[index] = node;
+	if (count <= 1 || depth >= BvhMaxDepth)
+	{
+		return;
+	}
+
+	// Cheapest split between bins along any axis, by the areas of both sides times their counts
+	float bestCost = FLT_MAX;
+	int bestAxis = -1, bestSplit = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float extent = centreMax[axis] - centreMin[axis];
+		if (extent <= 0.0f)
+		{
+			continue;
+		}
+
+		glm::vec3 binMin[BvhBins], binMax[BvhBins];
+		uint32_t binCount[BvhBins] = {};
+		std::fill(binMin, binMin + BvhBins, glm::vec3(FLT_MAX));
+		std::fill(binMax, binMax + BvhBins, glm::vec3(-FLT_MAX));
+		float scale = BvhBins / extent;
+		for (uint32_t i = first; i < first + count; i++)
+		{
+			uint32_t slot = order[i];
+			int bin = std::min(static_cast<int>((centres[slot][axis] - centreMin[axis]) * scale), BvhBins - 1);
+			binCount[bin]++;
+			if (boundsMin[slot].x <= boundsMax[slot].x)
+			{
+				binMin[bin] = glm::min(binMin[bin], boundsMin[slot]);
+				binMax[bin] = glm::max(binMax[bin], boundsMax[slot]);
+			}
+		}
+
+		// Area and count of bins [split, BvhBins), then sweep the left side across
+		float rightArea[BvhBins];
+		uint32_t rightCount[BvhBins];
+		glm::vec3 sideMin(FLT_MAX), sideMax(-FLT_MAX);
+		uint32_t sideCount = 0;
+		for (int bin = BvhBins - 1; bin > 0; bin--)
+		{
+			sideMin = glm::min(sideMin, binMin[bin]);
+			sideMax = glm::max(sideMax, binMax[bin]);
+			sideCount += binCount[bin];
+			rightArea[bin] = SurfaceArea(sideMin, sideMax);
+			rightCount[bin] = sideCount;
+		}
+		sideMin = glm::vec3(FLT_MAX);
+		sideMax = glm::vec3(-FLT_MAX);
+		sideCount = 0;
+		for (int split = 1; split < BvhBins; split++)
+		{
+			sideMin = glm::min(sideMin, binMin[split - 1]);
+			sideMax = glm::max(sideMax, binMax[split - 1]);
+			sideCount += binCount[split - 1];
+			if (sideCount == 0 || rightCount[split] == 0)
+			{
+				continue;
+			}
+			float cost = SurfaceArea(sideMin, sideMax) * sideCount + rightArea[split] * rightCount[split];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = split;
+			}
+		}
+	}
+
+	uint32_t middle;
+	if (bestAxis < 0)
+	{
+		// Every centre in one place, only worth halving when that is too many for a leaf
+		if (count <= BvhMaxLeafSize)
+		{
+			return;
+		}
+		middle = first + count / 2;
+	}
+	else
+	{
+		float area = SurfaceArea(node.boundsMin, node.boundsMax);
+		if (count <= BvhMaxLeafSize && area * count <= BvhTraversalCost * area + bestCost)
+		{
+			return;
+		}
+		float scale = BvhBins / (centreMax[bestAxis] - centreMin[bestAxis]);
+		auto below = std::partition(order.begin() + first, order.begin() + first + count, [&](uint32_t slot) {
+			int bin = std::min(static_cast<int>((centres[slot][bestAxis] - centreMin[bestAxis]) * scale), BvhBins - 1);
+			return bin < bestSplit;
+		});
+		middle = static_cast<uint32_t>(below - order.begin());
+	}
+
+	buildNode(first, middle - first, depth + 1);
+	uint32_t right = static_cast<uint32_t>(bvh.nodes.size());
+	buildNode(middle, first + count - middle, depth + 1);
+	bvh.nodes[index].right = right;
+}
+
+void SceneBvh::build(const FrustumCuller &boxes, const std::vector<CullRange> &ranges)
+{
+	std::unique_lock<std::shared_mutex> lock(mutex);
+
+	Builder builder(*this);
+	primitives.clear();
+	for (const CullRange &range : ranges)
+	{
+		for (uint32_t box = range.first; box < range.first + range.count; box++)
+		{
+			glm::vec3 boundsMin, boundsMax;
+			boxes.get(box, boundsMin, boundsMax);
+			builder.order.push_back(static_cast<uint32_t>(primitives.size()));
+			builder.boundsMin.push_back(boundsMin);
+			builder.boundsMax.push_back(boundsMax);
+			builder.centres.push_back((boundsMin + boundsMax) * 0.5f);
+			primitives.push_back(box);
+		}
+	}
+
+	nodes.clear();
+	nodes.reserve(primitives.size() * 2);
+	if (!primitives.empty())
+	{
+		builder.buildNode(0, static_cast<uint32_t>(primitives.size()), 0);
+	}
+
+	// Primitives in the order the leaves own them
+	std::vector<uint32_t> boxOfSlot = primitives;
+	primitiveMin.resize(primitives.size());
+	primitiveMax.resize(primitives.size());
+	for (size_t i = 0; i < primitives.size(); i++)
+	{
+		uint32_t slot = builder.order[i];
+		primitives[i] = boxOfSlot[slot];
+		primitiveMin[i] = builder.boundsMin[slot];
+		primitiveMax[i] = builder.boundsMax[slot];
+	}
+	revision = boxes.revision();
+}
+
+void SceneBvh::refit(const FrustumCuller &boxes)
+{
+	std::unique_lock<std::shared_mutex> lock(mutex);
+	if (boxes.revision() == revision)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < primitives.size(); i++)
+	{
+		boxes.get(primitives[i], primitiveMin[i], primitiveMax[i]);
+	}
+
+	// Children come after their parent, so walking backwards refits them first
+	for (size_t n = nodes.size(); n-- > 0;)
+	{
+		Node &node = nodes[n];
+		node.boundsMin = glm::vec3(FLT_MAX);
+		node.boundsMax = glm::vec3(-FLT_MAX);
+		if (node.right == 0)
+		{
+			for (uint32_t i = node.first; i < node.first + node.count; i++)
+			{
+				if (!isEmpty(i))
+				{
+					node.boundsMin = glm::min(node.boundsMin, primitiveMin[i]);
+					node.boundsMax = glm::max(node.boundsMax, primitiveMax[i]);
+				}
+			}
+		}
+		else
+		{
+			node.boundsMin = glm::min(nodes[n + 1].boundsMin, nodes[node.right].boundsMin);
+			node.boundsMax = glm::max(nodes[n + 1].boundsMax, nodes[node.right].boundsMax);
+		}
+	}
+	revision = boxes.revision();
+}
+
+bool SceneBvh::isEmpty(uint32_t primitive) const
+{
+	return primitiveMin[primitive].x > primitiveMax[primitive].x;
+}
+
+void SceneBvh::appendSubtree(const Node &node, std::vector<uint32_t> &boxes) const
+{
+	for (uint32_t i = node.first; i < node.first + node.count; i++)
+	{
+		if (!isEmpty(i))
+		{
+			boxes.push_back(primitives[i]);
+		}
+	}
+}
+
+void SceneBvh::query(const Frustum &frustum, std::vector<uint32_t> &boxes) const
+{
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	if (nodes.empty()) return;
+
+	uint32_t stack[BvhStackSize];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		uint32_t index = stack[--top];
+		const Node &node = nodes[index];
+		Containment containment = Classify(frustum, node.boundsMin, node.boundsMax);
+		if (containment == OUTSIDE || node.boundsMin.x > node.boundsMax.x)
+		{
+			continue;
+		}
+		if (containment == INSIDE)
+		{
+			appendSubtree(node, boxes);
+		}
+		else if (node.right == 0)
+		{
+			for (uint32_t i = node.first; i < node.first + node.count; i++)
+			{
+				if (!isEmpty(i) && Classify(frustum, primitiveMin[i], primitiveMax[i]) != OUTSIDE)
+				{
+					boxes.push_back(primitives[i]);
+				}
+			}
+		}
+		else
+		{
+			stack[top++] = node.right;
+			stack[top++] = index + 1;
+		}
+	}
+}
+
+void SceneBvh::query(const glm::vec3 &centre, float radius, std::vector<uint32_t> &boxes) const
+{
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	if (nodes.empty()) return;
+
+	uint32_t stack[BvhStackSize];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		uint32_t index = stack[--top];
+		const Node &node = nodes[index];
+		if (node.boundsMin.x > node.boundsMax.x || !Overlaps(centre, radius, node.boundsMin, node.boundsMax))
+		{
+			continue;
+		}
+		if (node.right == 0)
+		{
+			for (uint32_t i = node.first; i < node.first + node.count; i++)
+			{
+				if (!isEmpty(i) && Overlaps(centre, radius, primitiveMin[i], primitiveMax[i]))
+				{
+					boxes.push_back(primitives[i]);
+				}
+			}
+		}
+		else
+		{
+			stack[top++] = node.right;
+			stack[top++] = index + 1;
+		}
+	}
+}
+
+void SceneBvh::query(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, std::vector<uint32_t> &boxes) const
+{
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	if (nodes.empty()) return;
+
+	uint32_t stack[BvhStackSize];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		uint32_t index = stack[--top];
+		const Node &node = nodes[index];
+		if (node.boundsMin.x > node.boundsMax.x || !Overlaps(boundsMin, boundsMax, node.boundsMin, node.boundsMax))
+		{
+			continue;
+		}
+		if (node.right == 0)
+		{
+			for (uint32_t i = node.first; i < node.first + node.count; i++)
+			{
+				if (!isEmpty(i) && Overlaps(boundsMin, boundsMax, primitiveMin[i], primitiveMax[i]))
+				{
+					boxes.push_back(primitives[i]);
+				}
+			}
+		}
+		else
+		{
+			stack[top++] = node.right;
+			stack[top++] = index + 1;
+		}
+	}
+}
+
+bool SceneBvh::raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, RayHit &hit) const
+{
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	if (nodes.empty()) return false;
+
+	glm::vec3 inverseDirection = 1.0f / direction;
+	float nearest = maxDistance;
+	bool found = false;
+
+	uint32_t stack[BvhStackSize];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		uint32_t index = stack[--top];
+		const Node &node = nodes[index];
+		if (node.boundsMin.x > node.boundsMax.x || Enter(origin, inverseDirection, nearest, node.boundsMin, node.boundsMax) < 0.0f)
+		{
+			continue;
+		}
+		if (node.right == 0)
+		{
+			for (uint32_t i = node.first; i < node.first + node.count; i++)
+			{
+				float distance = isEmpty(i) ? -1.0f : Enter(origin, inverseDirection, nearest, primitiveMin[i], primitiveMax[i]);
+				if (distance >= 0.0f)
+				{
+					nearest = distance;
+					hit.box = primitives[i];
+					hit.distance = distance;
+					found = true;
+				}
+			}
+		}
+		else
+		{
+			// Nearer child on top, so its hits shorten the ray before the other is visited
+			const Node &left = nodes[index + 1], &right = nodes[node.right];
+			float leftEnter = Enter(origin, inverseDirection, nearest, left.boundsMin, left.boundsMax);
+			float rightEnter = Enter(origin, inverseDirection, nearest, right.boundsMin, right.boundsMax);
+			bool leftFirst = rightEnter < 0.0f || (leftEnter >= 0.0f && leftEnter <= rightEnter);
+			stack[top++] = leftFirst ? node.right : index + 1;
+			stack[top++] = leftFirst ? index + 1 : node.right;
+		}
+	}
+	return found;
+}
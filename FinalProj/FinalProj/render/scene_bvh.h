@@ -0,0 +1,67 @@
+#ifndef _SCENE_BVH_H_
+#define _SCENE_BVH_H_
+
+#include <cstdint>
+#include <shared_mutex>
+#include <vector>
+#include <glm/glm.hpp>
+#include "frustum_culler.h"
+
+// Bounding volume hierarchy over boxes of a FrustumCuller, for the queries that should not
+// visit every object: frustum, ray, sphere and box. The tree is built top down, splitting
+// each node where the surface area heuristic, evaluated over binned box centres, is lowest.
+// When boxes move it is refit in place: every node grows or shrinks around its children,
+// which keeps queries exact but the tree no tighter than its build.
+//
+// Queries report boxes by their index in the culler. Any number of threads may query at
+// once; build() and refit() wait for them and hold them off while writing.
+class SceneBvh
+{
+public:
+	struct RayHit
+	{
+		uint32_t box = 0;
+		float distance = 0.0f;	// Along the ray, 0 when it starts inside the box
+	};
+
+	// Builds the tree over the boxes of ranges, as they are in boxes now
+	void build(const FrustumCuller &boxes, const std::vector<CullRange> &ranges);
+
+	// Reads the boxes again and refits every node around them. Does nothing when no box
+	// changed since the last build or refit.
+	void refit(const FrustumCuller &boxes);
+
+	// Each appends the boxes that intersect the volume, in no particular order
+	void query(const Frustum &frustum, std::vector<uint32_t> &boxes) const;
+	void query(const glm::vec3 &centre, float radius, std::vector<uint32_t> &boxes) const;
+	void query(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, std::vector<uint32_t> &boxes) const;
+
+	// Nearest box the ray from origin along direction enters within maxDistance. Returns
+	// false when it hits none.
+	bool raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, RayHit &hit) const;
+
+private:
+	// Interior nodes have their left child right after them and their right one at right.
+	// Every node owns primitives [first, first + count), leaves are those with right 0.
+	struct Node
+	{
+		glm::vec3 boundsMin;
+		uint32_t first;
+		glm::vec3 boundsMax;
+		uint32_t count;
+		uint32_t right;
+	};
+
+	struct Builder;
+
+	void appendSubtree(const Node &node, std::vector<uint32_t> &boxes) const;
+	bool isEmpty(uint32_t primitive) const;
+
+	std::vector<Node> nodes;
+	std::vector<uint32_t> primitives;				// Culler boxes, each node's contiguous
+	std::vector<glm::vec3> primitiveMin, primitiveMax;	// Bounds in primitives order
+	uint64_t revision = 0;
+	mutable std::shared_mutex mutex;
+};
+
+#endif
@@ -1,54 +1,133 @@
 #include "shader.h"
+#include "frame_constants.h"
+#include "gl_extensions.h"
 
+#include <asset/derived_data_cache.h>
+#include <asset/virtual_file_system.h>
 #include <string> 
 #include <iostream> 
 #include <fstream>
 #include <sstream> 
 #include <vector>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
 
-GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_file_path)
+// Attaches the shared uniform blocks a program declares to their fixed binding points
+static void BindUniformBlocks(GLuint ProgramID)
 {
-	// Create the shaders
-	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+	GLuint blockIndex = glGetUniformBlockIndex(ProgramID, "FrameConstants");
+	if (blockIndex != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(ProgramID, blockIndex, FRAME_CONSTANTS_BINDING);
+	}
+}
 
-	// Read the Vertex Shader code from the file
-	std::string VertexShaderCode;
-	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-	if (VertexShaderStream.is_open())
+// Linked programs shared by every caller loading the same sources
+struct CachedProgram
+{
+	GLuint ProgramID;
+	int References;
+};
+static std::unordered_map<uint64_t, CachedProgram> ProgramCache;
+
+static const uint32_t ProgramBinaryVersion = 2;
+
+// Derived data entry of a program binary: this header, then Length bytes of binary
+struct ProgramBinaryHeader
+{
+	uint32_t Format;
+	uint32_t Length;
+};
+
+// Key of a program: both sources plus the driver, since binaries are only valid for the driver that produced them
+static DerivedDataKey ProgramKey(const std::string &VertexShaderCode, const std::string &FragmentShaderCode)
+{
+	DerivedDataKey Key("program", ProgramBinaryVersion);
+	Key.add(VertexShaderCode).add("\0", 1).add(FragmentShaderCode);
+	const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	for (GLenum name : driverStrings)
 	{
-		std::stringstream sstr;
-		sstr << VertexShaderStream.rdbuf();
-		VertexShaderCode = sstr.str();
-		VertexShaderStream.close();
+		const char *value = reinterpret_cast<const char *>(glGetString(name));
+		if (value)
+		{
+			Key.add(value, strlen(value));
+		}
 	}
-	else
+	return Key;
+}
+
+// Tries to create the program from a binary saved by an earlier run. Returns 0 when there is none or the driver rejects it.
+static GLuint LoadProgramBinary(const DerivedDataKey &Key)
+{
+	if (!glExtensions.programBinary)
 	{
-		printf("Vertex shader not found %s.\n", vertex_file_path);
 		return 0;
 	}
 
-	// Read the Fragment Shader code from the file
-	std::string FragmentShaderCode;
-	std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-	if (FragmentShaderStream.is_open())
+	std::shared_ptr<MappedFile> Entry = DerivedDataCache::find(Key);
+	ProgramBinaryHeader Header;
+	if (!Entry || Entry->size() < sizeof(Header))
 	{
-		std::stringstream sstr;
-		sstr << FragmentShaderStream.rdbuf();
-		FragmentShaderCode = sstr.str();
-		FragmentShaderStream.close();
+		return 0;
 	}
-	else
+	memcpy(&Header, Entry->data(), sizeof(Header));
+	if (sizeof(Header) + Header.Length > Entry->size())
 	{
-		printf("Fragment shader not found %s.\n", fragment_file_path);
 		return 0;
 	}
 
+	GLuint ProgramID = glCreateProgram();
+	glExtensions.ProgramBinary(ProgramID, Header.Format, Entry->data() + sizeof(Header), Header.Length);
+
+	GLint Result = GL_FALSE;
+	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
+	if (!Result)
+	{
+		glDeleteProgram(ProgramID);
+		return 0;
+	}
+	return ProgramID;
+}
+
+static void SaveProgramBinary(const DerivedDataKey &Key, GLuint ProgramID)
+{
+	if (!glExtensions.programBinary)
+	{
+		return;
+	}
+
+	GLint Length = 0;
+	glGetProgramiv(ProgramID, GL_PROGRAM_BINARY_LENGTH, &Length);
+	if (Length <= 0)
+	{
+		return;
+	}
+
+	ProgramBinaryHeader Header = { 0, 0 };
+	std::vector<char> Entry(sizeof(Header) + Length);
+	GLsizei Written = 0;
+	glExtensions.GetProgramBinary(ProgramID, Length, &Written, &Header.Format, Entry.data() + sizeof(Header));
+	Header.Length = static_cast<uint32_t>(Written);
+	memcpy(Entry.data(), &Header, sizeof(Header));
+
+	DerivedDataCache::store(Key, Entry.data(), sizeof(Header) + Written);
+}
+
+// Compiles and links a program. Names are only used in log messages.
+static GLuint CompileProgram(const std::string &VertexShaderCode, const std::string &FragmentShaderCode,
+							 const char *vertex_name, const char *fragment_name)
+{
+	// Create the shaders
+	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
+	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+
 	GLint Result = GL_FALSE;
 	int InfoLogLength;
 
 	// Compile Vertex Shader
-	printf("Compiling vertex shader : %s\n", vertex_file_path);
+	printf("Compiling vertex shader : %s\n", vertex_name);
 	char const *VertexSourcePointer = VertexShaderCode.c_str();
 	glShaderSource(VertexShaderID, 1, &VertexSourcePointer, NULL);
 	glCompileShader(VertexShaderID);
@@ -56,18 +135,20 @@ GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_fi
 	// Check Vertex Shader
 	glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
 	if (!Result) {
-		printf("Error compiling vertex shader : %s\n", vertex_file_path);
+		printf("Error compiling vertex shader : %s\n", vertex_name);
 		glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
 		if (InfoLogLength > 0) {
 			std::vector<char> VertexShaderErrorMessage(InfoLogLength + 1);
 			glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
 			printf("%s\n", &VertexShaderErrorMessage[0]);
 		}
+		glDeleteShader(VertexShaderID);
+		glDeleteShader(FragmentShaderID);
 		return 0;
 	}
 
 	// Compile Fragment Shader
-	printf("Compiling fragment shader : %s\n", fragment_file_path);
+	printf("Compiling fragment shader : %s\n", fragment_name);
 	char const *FragmentSourcePointer = FragmentShaderCode.c_str();
 	glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer, NULL);
 	glCompileShader(FragmentShaderID);
@@ -75,7 +156,7 @@ GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_fi
 	// Check Fragment Shader
 	glGetShaderiv(FragmentShaderID, GL_COMPILE_STATUS, &Result);
 	if (!Result) {
-		printf("Error compiling fragment shader : %s\n", fragment_file_path);
+		printf("Error compiling fragment shader : %s\n", fragment_name);
 		glGetShaderiv(FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
 		if (InfoLogLength > 0)
 		{
@@ -83,6 +164,8 @@ GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_fi
 			glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
 			printf("%s\n", &FragmentShaderErrorMessage[0]);
 		}
+		glDeleteShader(VertexShaderID);
+		glDeleteShader(FragmentShaderID);
 		return 0;
 	}
 
@@ -91,8 +174,18 @@ GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_fi
 	GLuint ProgramID = glCreateProgram();
 	glAttachShader(ProgramID, VertexShaderID);
 	glAttachShader(ProgramID, FragmentShaderID);
+	if (glExtensions.programBinary)
+	{
+		glExtensions.ProgramParameteri(ProgramID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
 	glLinkProgram(ProgramID);
 
+	glDetachShader(ProgramID, VertexShaderID);
+	glDetachShader(ProgramID, FragmentShaderID);
+
+	glDeleteShader(VertexShaderID);
+	glDeleteShader(FragmentShaderID);
+
 	// Check the program
 	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
 	if (!Result) {
@@ -104,92 +197,172 @@ GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_fi
 			glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
 			printf("%s\n", &ProgramErrorMessage[0]);
 		}
+		glDeleteProgram(ProgramID);
 		return 0;
 	}
 
-	glDetachShader(ProgramID, VertexShaderID);
-	glDetachShader(ProgramID, FragmentShaderID);
+	return ProgramID;
+}
 
-	glDeleteShader(VertexShaderID);
-	glDeleteShader(FragmentShaderID);
+// Returns the cached program for these sources, or loads/compiles it and adds it to the cache
+static GLuint LoadProgram(const std::string &VertexShaderCode, const std::string &FragmentShaderCode,
+						  const char *vertex_name, const char *fragment_name)
+{
+	DerivedDataKey Key = ProgramKey(VertexShaderCode, FragmentShaderCode);
 
+	auto it = ProgramCache.find(Key.hash());
+	if (it != ProgramCache.end())
+	{
+		it->second.References++;
+		return it->second.ProgramID;
+	}
+
+	GLuint ProgramID = LoadProgramBinary(Key);
+	if (ProgramID != 0)
+	{
+		printf("Loaded program binary : %s, %s\n", vertex_name, fragment_name);
+	}
+	else
+	{
+		ProgramID = CompileProgram(VertexShaderCode, FragmentShaderCode, vertex_name, fragment_name);
+		if (ProgramID == 0)
+		{
+			return 0;
+		}
+		SaveProgramBinary(Key, ProgramID);
+	}
+
+	BindUniformBlocks(ProgramID);
+
+	ProgramCache[Key.hash()] = { ProgramID, 1 };
 	return ProgramID;
 }
 
-GLuint LoadShadersFromString(std::string VertexShaderCode, std::string FragmentShaderCode)
+static bool ReadShaderFile(const char *file_path, std::string &Code)
 {
-	// Create the shaders
-	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
-
-	GLint Result = GL_FALSE;
-	int InfoLogLength;
+	VirtualFile ShaderFile = VirtualFileSystem::open(file_path);
+	if (!ShaderFile.valid())
+	{
+		return false;
+	}
+	Code = ShaderFile.text();
+	return true;
+}
 
-	// Compile Vertex Shader
-	printf("Compiling vertex shader\n");
-	char const *VertexSourcePointer = VertexShaderCode.c_str();
-	glShaderSource(VertexShaderID, 1, &VertexSourcePointer, NULL);
-	glCompileShader(VertexShaderID);
+GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_file_path)
+{
+	// Read the Vertex Shader code from the file
+	std::string VertexShaderCode;
+	if (!ReadShaderFile(vertex_file_path, VertexShaderCode))
+	{
+		printf("Vertex shader not found %s.\n", vertex_file_path);
+		return 0;
+	}
 
-	// Check Vertex Shader
-	glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
-	if (!Result) {
-		printf("Error compiling vertex shader\n");
-		glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-		if (InfoLogLength > 0) {
-			std::vector<char> VertexShaderErrorMessage(InfoLogLength + 1);
-			glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
-			printf("%s\n", &VertexShaderErrorMessage[0]);
-		}
+	// Read the Fragment Shader code from the file
+	std::string FragmentShaderCode;
+	if (!ReadShaderFile(fragment_file_path, FragmentShaderCode))
+	{
+		printf("Fragment shader not found %s.\n", fragment_file_path);
 		return 0;
 	}
 
-	// Compile Fragment Shader
-	printf("Compiling fragment shader\n");
-	char const *FragmentSourcePointer = FragmentShaderCode.c_str();
-	glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer, NULL);
-	glCompileShader(FragmentShaderID);
+	return LoadProgram(VertexShaderCode, FragmentShaderCode, vertex_file_path, fragment_file_path);
+}
 
-	// Check Fragment Shader
-	glGetShaderiv(FragmentShaderID, GL_COMPILE_STATUS, &Result);
-	if (!Result) {
-		printf("Error compiling fragment shader\n");
-		glGetShaderiv(FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-		if (InfoLogLength > 0)
+GLuint LoadShadersFromString(std::string VertexShaderCode, std::string FragmentShaderCode)
+{
+	return LoadProgram(VertexShaderCode, FragmentShaderCode, "<string>", "<string>");
+}
+
+void ReleaseShaders(GLuint ProgramID)
+{
+	for (auto it = ProgramCache.begin(); it != ProgramCache.end(); ++it)
+	{
+		if (it->second.ProgramID == ProgramID)
 		{
-			std::vector<char> FragmentShaderErrorMessage(InfoLogLength + 1);
-			glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
-			printf("%s\n", &FragmentShaderErrorMessage[0]);
+			if (--it->second.References == 0)
+			{
+				glDeleteProgram(ProgramID);
+				ProgramCache.erase(it);
+			}
+			return;
 		}
-		return 0;
 	}
+}
 
-	// Link the program
-	printf("Linking program\n");
-	GLuint ProgramID = glCreateProgram();
-	glAttachShader(ProgramID, VertexShaderID);
-	glAttachShader(ProgramID, FragmentShaderID);
-	glLinkProgram(ProgramID);
+// Adds name to a location table, registering arrays under their base name as well
+static void AddLocation(std::vector<std::pair<uint32_t, GLint>> &table, std::string name, GLint location)
+{
+	table.push_back(std::make_pair(ShaderNameHash(name.c_str()), location));
+	size_t bracket = name.find('[');
+	if (bracket != std::string::npos)
+	{
+		name.resize(bracket);
+		table.push_back(std::make_pair(ShaderNameHash(name.c_str()), location));
+	}
+}
 
-	// Check the program
-	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
-	if (!Result) {
-		printf("Error linking program\n");
-		glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-		if (InfoLogLength > 0)
+static void SortLocations(std::vector<std::pair<uint32_t, GLint>> &table, GLuint programID)
+{
+	std::sort(table.begin(), table.end());
+	table.erase(std::unique(table.begin(), table.end()), table.end());
+	for (size_t i = 1; i < table.size(); i++)
+	{
+		if (table[i].first == table[i - 1].first)
 		{
-			std::vector<char> ProgramErrorMessage(InfoLogLength + 1);
-			glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
-			printf("%s\n", &ProgramErrorMessage[0]);
+			printf("Shader name hash collision in program %u\n", programID);
 		}
-		return 0;
 	}
+}
 
-	glDetachShader(ProgramID, VertexShaderID);
-	glDetachShader(ProgramID, FragmentShaderID);
+void ShaderProgram::reflect(GLuint programID)
+{
+	this->programID = programID;
+	uniforms.clear();
+	attributes.clear();
+	if (programID == 0)
+	{
+		return;
+	}
 
-	glDeleteShader(VertexShaderID);
-	glDeleteShader(FragmentShaderID);
+	GLint count = 0, maxLength = 0;
+	GLint size;
+	GLenum type;
 
-	return ProgramID;
+	// Uniforms
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+	std::vector<char> name(maxLength + 1);
+	for (GLint i = 0; i < count; i++)
+	{
+		glGetActiveUniform(programID, i, maxLength + 1, NULL, &size, &type, &name[0]);
+		GLint location = glGetUniformLocation(programID, &name[0]);
+		if (location >= 0)		// Uniform block members have no location
+		{
+			AddLocation(uniforms, &name[0], location);
+		}
+	}
+	SortLocations(uniforms, programID);
+
+	// Attributes
+	glGetProgramiv(programID, GL_ACTIVE_ATTRIBUTES, &count);
+	glGetProgramiv(programID, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+	name.resize(maxLength + 1);
+	for (GLint i = 0; i < count; i++)
+	{
+		glGetActiveAttrib(programID, i, maxLength + 1, NULL, &size, &type, &name[0]);
+		AddLocation(attributes, &name[0], glGetAttribLocation(programID, &name[0]));
+	}
+	SortLocations(attributes, programID);
+}
+
+GLint ShaderProgram::find(const LocationTable &table, uint32_t nameHash)
+{
+	auto it = std::lower_bound(table.begin(), table.end(), std::make_pair(nameHash, std::numeric_limits<GLint>::min()));
+	if (it != table.end() && it->first == nameHash)
+	{
+		return it->second;
+	}
+	return -1;
 }
@@ -2,10 +2,65 @@
 #define _SHADER_H_
 
 #include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <cstdint>
 #include <string>
+#include <utility>
+#include <vector>
 
+// Programs are cached by source: loading the same shaders again returns the same program.
+// Where program binaries are supported, linked programs are also stored in the
+// DerivedDataCache, under derived_data/, and reused by later runs without compiling GLSL.
 GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_file_path);
 
 GLuint LoadShadersFromString(std::string VertexShaderCode, std::string FragmentShaderCode);
 
+// Drops one reference to a program from the loaders above, deleting it with the last one
+void ReleaseShaders(GLuint ProgramID);
+
+// FNV-1a hash of a uniform or attribute name, usable at compile time
+constexpr uint32_t ShaderNameHash(const char *name, uint32_t hash = 2166136261u)
+{
+	return *name ? ShaderNameHash(name + 1, (hash ^ static_cast<uint8_t>(*name)) * 16777619u) : hash;
+}
+
+// Linked program with every active uniform and attribute location looked up once.
+// Lookups by name or hash never reach the driver, so they are safe to do per draw,
+// though callers should still cache the handles they use every frame.
+class ShaderProgram
+{
+public:
+	ShaderProgram() = default;
+	explicit ShaderProgram(GLuint programID) { reflect(programID); }
+
+	// Queries the active uniforms and attributes of programID
+	void reflect(GLuint programID);
+
+	GLuint id() const { return programID; }
+	bool valid() const { return programID != 0; }
+	void use() const { glUseProgram(programID); }
+
+	// Locations are -1 for names that are not active in the program
+	GLint uniform(uint32_t nameHash) const { return find(uniforms, nameHash); }
+	GLint uniform(const char *name) const { return uniform(ShaderNameHash(name)); }
+	GLint attribute(uint32_t nameHash) const { return find(attributes, nameHash); }
+	GLint attribute(const char *name) const { return attribute(ShaderNameHash(name)); }
+
+	// Setters for the currently bound program
+	static void set(GLint location, int value) { glUniform1i(location, value); }
+	static void set(GLint location, float value) { glUniform1f(location, value); }
+	static void set(GLint location, const glm::vec2 &value) { glUniform2fv(location, 1, &value[0]); }
+	static void set(GLint location, const glm::vec3 &value) { glUniform3fv(location, 1, &value[0]); }
+	static void set(GLint location, const glm::mat4 &value) { glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]); }
+
+private:
+	typedef std::vector<std::pair<uint32_t, GLint>> LocationTable;	// Sorted by name hash
+
+	static GLint find(const LocationTable &table, uint32_t nameHash);
+
+	GLuint programID = 0;
+	LocationTable uniforms;
+	LocationTable attributes;
+};
+
 #endif
@@ -0,0 +1,185 @@
+#include "texture_cook.h"
+#include "block_compression.h"
+#include "texture_manager.h"
+
+#include <algorithm>
+#include <cstring>
+
+static const uint64_t CookedLevelAlignment = 16;
+
+DerivedDataKey CookedTextureKey(const std::string &sourcePath, bool compress)
+{
+	DerivedDataKey key("texture", COOKED_TEXTURE_VERSION);
+	// The path picks the format of normal maps
+	key.add(static_cast<uint64_t>(compress)).add(sourcePath);
+	return key.addFile(sourcePath);
+}
+
+static size_t LevelSize(CookedTextureFormat format, int width, int height)
+{
+	switch (format)
+	{
+	case COOKED_TEXTURE_BC1:
+		return BlockCompressedSize(width, height, 8);
+	case COOKED_TEXTURE_BC3:
+	case COOKED_TEXTURE_BC5:
+		return BlockCompressedSize(width, height, 16);
+	default:
+		return static_cast<size_t>(width) * height * 4;
+	}
+}
+
+std::shared_ptr<const CookedImage> ReadCookedTexture(const DerivedDataKey &key)
+{
+	std::shared_ptr<CookedImage> image = std::make_shared<CookedImage>();
+	image->file = DerivedDataCache::find(key);
+	if (!image->file || image->file->size() < sizeof(CookedTextureHeader))
+	{
+		return nullptr;
+	}
+
+	CookedTextureHeader header;
+	memcpy(&header, image->file->data(), sizeof(header));
+	if (header.magic != COOKED_TEXTURE_MAGIC || header.version != COOKED_TEXTURE_VERSION
+		|| header.format > COOKED_TEXTURE_BC5 || header.levelCount == 0
+		|| sizeof(header) + header.levelCount * sizeof(CookedTextureLevel) > image->file->size())
+	{
+		return nullptr;
+	}
+
+	image->format = static_cast<CookedTextureFormat>(header.format);
+	const unsigned char *levelTable = image->file->data() + sizeof(header);
+	for (uint32_t i = 0; i < header.levelCount; i++)
+	{
+		CookedTextureLevel level;
+		memcpy(&level, levelTable + i * sizeof(level), sizeof(level));
+		if (level.offset + level.size > image->file->size()
+			|| level.size != LevelSize(image->format, level.width, level.height))
+		{
+			return nullptr;
+		}
+		image->levels.push_back({ static_cast<int>(level.width), static_cast<int>(level.height),
+								  image->file->data() + level.offset, static_cast<size_t>(level.size) });
+	}
+	return image;
+}
+
+// 2x2 box filter, the last row or column is reused when a side is odd
+static std::vector<unsigned char> Downsample(const std::vector<unsigned char> &src, int width, int height, int &outWidth, int &outHeight)
+{
+	outWidth = std::max(1, width / 2);
+	outHeight = std::max(1, height / 2);
+	std::vector<unsigned char> dst(static_cast<size_t>(outWidth) * outHeight * 4);
+	for (int y = 0; y < outHeight; y++)
+	{
+		int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+		for (int x = 0; x < outWidth; x++)
+		{
+			int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+			for (int c = 0; c < 4; c++)
+			{
+				int sum = src[(static_cast<size_t>(y0) * width + x0) * 4 + c] + src[(static_cast<size_t>(y0) * width + x1) * 4 + c]
+						+ src[(static_cast<size_t>(y1) * width + x0) * 4 + c] + src[(static_cast<size_t>(y1) * width + x1) * 4 + c];
+				dst[(static_cast<size_t>(y) * outWidth + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+			}
+		}
+	}
+	return dst;
+}
+
+static CookedTextureFormat ChooseFormat(const std::string &sourcePath, const unsigned char *rgba, size_t pixelCount)
+{
+	std::string name = sourcePath.substr(sourcePath.find_last_of("/\\") + 1);
+	if (name.find("_nor") != std::string::npos)
+	{
+		return COOKED_TEXTURE_BC5;
+	}
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		if (rgba[i * 4 + 3] != 255)
+		{
+			return COOKED_TEXTURE_BC3;
+		}
+	}
+	return COOKED_TEXTURE_BC1;
+}
+
+static void EncodeLevel(CookedTextureFormat format, const std::vector<unsigned char> &rgba, int width, int height, unsigned char *out)
+{
+	switch (format)
+	{
+	case COOKED_TEXTURE_BC1:
+		CompressBC1(rgba.data(), width, height, out);
+		break;
+	case COOKED_TEXTURE_BC3:
+		CompressBC3(rgba.data(), width, height, out);
+		break;
+	case COOKED_TEXTURE_BC5:
+		CompressBC5(rgba.data(), width, height, out);
+		break;
+	default:
+		memcpy(out, rgba.data(), rgba.size());
+		break;
+	}
+}
+
+bool WriteCookedTexture(const DerivedDataKey &key, const std::string &sourcePath, bool compress)
+{
+	CookedTextureHeader header = {};
+	header.magic = COOKED_TEXTURE_MAGIC;
+	header.version = COOKED_TEXTURE_VERSION;
+
+	Image image = DecodeImageRGBA(sourcePath.c_str());
+	if (!image.valid())
+	{
+		return false;
+	}
+	size_t pixelCount = static_cast<size_t>(image.width) * image.height;
+	CookedTextureFormat format = compress ? ChooseFormat(sourcePath, image.pixels.get(), pixelCount) : COOKED_TEXTURE_RGBA8;
+	header.format = format;
+	header.width = image.width;
+	header.height = image.height;
+
+	// Every level down to 1x1, each filtered from the one above
+	std::vector<std::vector<unsigned char>> levels;
+	std::vector<CookedTextureLevel> table;
+	levels.emplace_back(image.pixels.get(), image.pixels.get() + pixelCount * 4);
+	table.push_back({ static_cast<uint32_t>(image.width), static_cast<uint32_t>(image.height), 0, 0 });
+	image.pixels.reset();
+	while (table.back().width > 1 || table.back().height > 1)
+	{
+		int width, height;
+		levels.push_back(Downsample(levels.back(), table.back().width, table.back().height, width, height));
+		table.push_back({ static_cast<uint32_t>(width), static_cast<uint32_t>(height), 0, 0 });
+	}
+	header.levelCount = static_cast<uint32_t>(table.size());
+
+	uint64_t offset = sizeof(header) + table.size() * sizeof(CookedTextureLevel);
+	for (CookedTextureLevel &level : table)
+	{
+		offset = (offset + CookedLevelAlignment - 1) / CookedLevelAlignment * CookedLevelAlignment;
+		level.offset = offset;
+		level.size = LevelSize(format, level.width, level.height);
+		offset += level.size;
+	}
+
+	std::vector<unsigned char> file(offset, 0);
+	memcpy(file.data(), &header, sizeof(header));
+	memcpy(file.data() + sizeof(header), table.data(), table.size() * sizeof(CookedTextureLevel));
+	for (size_t i = 0; i < table.size(); i++)
+	{
+		EncodeLevel(format, levels[i], table[i].width, table[i].height, file.data() + table[i].offset);
+	}
+	return DerivedDataCache::store(key, file.data(), file.size());
+}
+
+std::shared_ptr<const CookedImage> CookTexture(const std::string &sourcePath, bool compress)
+{
+	DerivedDataKey key = CookedTextureKey(sourcePath, compress);
+	std::shared_ptr<const CookedImage> image = ReadCookedTexture(key);
+	if (!image && WriteCookedTexture(key, sourcePath, compress))
+	{
+		image = ReadCookedTexture(key);
+	}
+	return image;
+}
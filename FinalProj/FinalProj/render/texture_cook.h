@@ -0,0 +1,78 @@
+#ifndef _TEXTURE_COOK_H_
+#define _TEXTURE_COOK_H_
+
+#include <asset/derived_data_cache.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Cooked textures hold an image with its whole mip chain, already filtered and, where
+// possible, block compressed, so loading needs neither a JPEG/PNG decode nor
+// glGenerateMipmap. They live in the derived data cache. Layout, native endianness:
+//
+//   CookedTextureHeader
+//   CookedTextureLevel[levelCount]
+//   level data                       at each level's offset, on 16 byte boundaries
+enum CookedTextureFormat : uint32_t
+{
+	COOKED_TEXTURE_RGBA8 = 0,
+	COOKED_TEXTURE_BC1 = 1,		// Opaque colour
+	COOKED_TEXTURE_BC3 = 2,		// Colour with alpha
+	COOKED_TEXTURE_BC5 = 3		// Two channel normal maps
+};
+
+const uint32_t COOKED_TEXTURE_MAGIC = 0x58545046;	// "FPTX"
+const uint32_t COOKED_TEXTURE_VERSION = 2;
+
+struct CookedTextureHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levelCount;
+};
+
+struct CookedTextureLevel
+{
+	uint32_t width;
+	uint32_t height;
+	uint64_t offset;
+	uint64_t size;
+};
+
+// A cooked texture mapped into memory
+struct CookedImage
+{
+	struct Level
+	{
+		int width;
+		int height;
+		const unsigned char *data;
+		size_t size;
+	};
+
+	std::shared_ptr<MappedFile> file;
+	CookedTextureFormat format;
+	std::vector<Level> levels;
+};
+
+// Cache key of the cooked texture of sourcePath, block compressed or kept as RGBA8.
+// Invalid when the image file is missing.
+DerivedDataKey CookedTextureKey(const std::string &sourcePath, bool compress);
+
+// Maps the entry for key. Returns nullptr when there is none or it is malformed.
+std::shared_ptr<const CookedImage> ReadCookedTexture(const DerivedDataKey &key);
+
+// Decodes sourcePath, builds its box-filtered mip chain and stores it under key. When
+// compressing, normal maps (named *_nor*) become BC5, images with any translucent pixel
+// BC3 and all others BC1; otherwise the levels stay RGBA8.
+bool WriteCookedTexture(const DerivedDataKey &key, const std::string &sourcePath, bool compress);
+
+// Maps the cooked texture of sourcePath, cooking it first when the cache misses.
+// Returns nullptr when the image cannot be decoded.
+std::shared_ptr<const CookedImage> CookTexture(const std::string &sourcePath, bool compress);
+
+#endif
@@ -0,0 +1,306 @@
+#include "texture_manager.h"
+#include "block_compression.h"
+#include "gl_extensions.h"
+#include "pixel_unpack_ring.h"
+#include "texture_cook.h"
+
+#include <asset/thread_pool.h>
+#include <asset/virtual_file_system.h>
+#include <stb/stb_image.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+void ImageDeleter::operator()(unsigned char *pixels) const
+{
+	stbi_image_free(pixels);
+}
+
+Image DecodeImageRGBA(const char *file_path)
+{
+	VirtualFile file = VirtualFileSystem::open(file_path);
+	return file.valid() ? DecodeImageRGBA(file.data(), file.size()) : Image();
+}
+
+Image DecodeImageRGBA(const unsigned char *bytes, size_t size)
+{
+	Image image;
+	int channels;
+	image.pixels.reset(stbi_load_from_memory(bytes, static_cast<int>(size), &image.width, &image.height, &channels, 4));
+	return image;
+}
+
+Texture::~Texture()
+{
+	if (id != 0)
+	{
+		glDeleteTextures(1, &id);
+	}
+}
+
+// Weak references, so the cache itself never keeps a texture alive
+static std::unordered_map<std::string, std::weak_ptr<Texture>> &TextureCache()
+{
+	static std::unordered_map<std::string, std::weak_ptr<Texture>> cache;
+	return cache;
+}
+
+// Every texture created so far, so shutdown() can reach uncached ones too
+static std::vector<std::weak_ptr<Texture>> &LiveTextures()
+{
+	static std::vector<std::weak_ptr<Texture>> textures;
+	return textures;
+}
+
+static std::string TextureKey(const std::string &path, const TextureSampling &sampling)
+{
+	return path + '|' + std::to_string(sampling.wrap) + '|' + std::to_string(sampling.minFilter) + '|'
+		+ std::to_string(sampling.magFilter) + '|' + (sampling.mipmaps ? '1' : '0');
+}
+
+// Maps the cook of file_path this context can upload as it is: an uncompressed one, only
+// there when asked for with cook --rgba8 or cooked for a context without S3TC, wins, and a
+// block compressed one is only taken where the driver has S3TC
+static Image FindCookedImage(const std::string &file_path)
+{
+	Image image;
+	image.cooked = ReadCookedTexture(CookedTextureKey(file_path, false));
+	if (!image.cooked && glExtensions.textureCompressionS3TC)
+	{
+		image.cooked = ReadCookedTexture(CookedTextureKey(file_path, true));
+	}
+	if (image.cooked)
+	{
+		image.width = image.cooked->levels[0].width;
+		image.height = image.cooked->levels[0].height;
+	}
+	return image;
+}
+
+Image ReadTextureImage(const std::string &file_path)
+{
+	Image image = FindCookedImage(file_path);
+	if (!image.cooked)
+	{
+		image.cooked = CookTexture(file_path, glExtensions.textureCompressionS3TC);
+		if (!image.cooked)
+		{
+			return DecodeImageRGBA(file_path.c_str());
+		}
+		image.width = image.cooked->levels[0].width;
+		image.height = image.cooked->levels[0].height;
+	}
+	return image;
+}
+
+static TextureHandle CreateTexture(int width, int height, const TextureSampling &sampling)
+{
+	TextureHandle texture = std::make_shared<Texture>();
+	texture->width = width;
+	texture->height = height;
+
+	glGenTextures(1, &texture->id);
+	glBindTexture(GL_TEXTURE_2D, texture->id);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sampling.wrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, sampling.wrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, sampling.minFilter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampling.magFilter);
+	return texture;
+}
+
+// Uploads one level of the bound texture. The bytes are staged in the pixel unpack ring,
+// so the upload does not block on a copy; client memory is the fallback.
+// RGBA8 rows are always 4-byte aligned, so the driver can take them as they are.
+static void UploadLevel(GLint level, GLenum internalFormat, bool compressed, int width, int height,
+						const unsigned char *bytes, size_t size)
+{
+	PixelUnpackRing &ring = PixelUnpackRing::current();
+	PixelUnpackRing::Region staging = ring.allocate(static_cast<GLsizeiptr>(size));
+	const void *source = bytes;
+	if (staging.data)
+	{
+		memcpy(staging.data, bytes, size);
+		ring.unmap(staging);
+		source = reinterpret_cast<const void *>(staging.offset);
+	}
+	else
+	{
+		// Unbind the ring so the texture call reads bytes from client memory
+		ring.retire(staging);
+	}
+
+	if (compressed)
+	{
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, static_cast<GLsizei>(size), source);
+	}
+	else
+	{
+		glTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, source);
+	}
+	if (staging.data)
+	{
+		ring.retire(staging);
+	}
+}
+
+TextureHandle UploadTexture(int width, int height, const unsigned char *rgba, const TextureSampling &sampling)
+{
+	static const unsigned char white[4] = { 255, 255, 255, 255 };
+
+	TextureHandle texture = CreateTexture(rgba ? width : 1, rgba ? height : 1, sampling);
+	UploadLevel(0, GL_RGBA8, false, texture->width, texture->height, rgba ? rgba : white,
+				static_cast<size_t>(texture->width) * texture->height * 4);
+	if (sampling.mipmaps)
+	{
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+
+	return texture;
+}
+
+TextureHandle UploadTexture(const Image &image, const TextureSampling &sampling)
+{
+	if (!image.cooked)
+	{
+		return UploadTexture(image.width, image.height, image.pixels.get(), sampling);
+	}
+
+	const CookedImage &cooked = *image.cooked;
+	TextureHandle texture = CreateTexture(image.width, image.height, sampling);
+	size_t levelCount = sampling.mipmaps ? cooked.levels.size() : 1;
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levelCount - 1));
+
+	// S3TC levels are decoded here when the driver lacks the extension
+	bool s3tc = glExtensions.textureCompressionS3TC;
+	std::vector<unsigned char> decoded;
+	for (size_t i = 0; i < levelCount; i++)
+	{
+		const CookedImage::Level &level = cooked.levels[i];
+		GLint index = static_cast<GLint>(i);
+		switch (cooked.format)
+		{
+		case COOKED_TEXTURE_BC1:
+		case COOKED_TEXTURE_BC3:
+			if (s3tc)
+			{
+				GLenum format = cooked.format == COOKED_TEXTURE_BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+				UploadLevel(index, format, true, level.width, level.height, level.data, level.size);
+				break;
+			}
+			decoded.resize(static_cast<size_t>(level.width) * level.height * 4);
+			if (cooked.format == COOKED_TEXTURE_BC1)
+			{
+				DecompressBC1(level.data, level.width, level.height, decoded.data());
+			}
+			else
+			{
+				DecompressBC3(level.data, level.width, level.height, decoded.data());
+			}
+			UploadLevel(index, GL_RGBA8, false, level.width, level.height, decoded.data(), decoded.size());
+			break;
+		case COOKED_TEXTURE_BC5:
+			UploadLevel(index, GL_COMPRESSED_RG_RGTC2, true, level.width, level.height, level.data, level.size);
+			break;
+		default:
+			UploadLevel(index, GL_RGBA8, false, level.width, level.height, level.data, level.size);
+			break;
+		}
+	}
+
+	return texture;
+}
+
+TextureHandle TextureManager::track(const TextureHandle &texture)
+{
+	std::vector<std::weak_ptr<Texture>> &live = LiveTextures();
+	live.erase(std::remove_if(live.begin(), live.end(), [](const std::weak_ptr<Texture> &t) { return t.expired(); }), live.end());
+	live.push_back(texture);
+	return texture;
+}
+
+TextureHandle TextureManager::create(int width, int height, const unsigned char *rgba, const TextureSampling &sampling)
+{
+	return track(UploadTexture(width, height, rgba, sampling));
+}
+
+TextureHandle TextureManager::create(const Image &image, const TextureSampling &sampling)
+{
+	return track(UploadTexture(image, sampling));
+}
+
+static TextureHandle FindTexture(const std::string &key)
+{
+	auto it = TextureCache().find(key);
+	return it != TextureCache().end() ? it->second.lock() : nullptr;
+}
+
+TextureHandle TextureManager::load(const std::string &path, const TextureSampling &sampling)
+{
+	std::string key = TextureKey(path, sampling);
+	if (TextureHandle texture = FindTexture(key))
+	{
+		return texture;
+	}
+
+	// load() runs on the render thread, so a miss is not cooked here: the file is decoded
+	// as it is and cooked on the shared pool for later runs
+	Image image = FindCookedImage(path);
+	if (!image.valid())
+	{
+		image = DecodeImageRGBA(path.c_str());
+		if (image.valid())
+		{
+			bool compress = glExtensions.textureCompressionS3TC;
+			ThreadPool::shared().submit([path, compress]() { CookTexture(path, compress); });
+		}
+	}
+	return adopt(path, image, sampling);
+}
+
+TextureHandle TextureManager::adopt(const std::string &path, const Image &image, const TextureSampling &sampling)
+{
+	std::string key = TextureKey(path, sampling);
+	if (TextureHandle texture = FindTexture(key))
+	{
+		return texture;
+	}
+
+	if (!image.valid())
+	{
+		std::cout << "Failed to load texture " << path << std::endl;
+	}
+
+	TextureHandle texture = create(image, sampling);
+	TextureCache()[key] = texture;
+	return texture;
+}
+
+TextureHandle TextureManager::adopt(const std::string &path, const TextureHandle &texture, const TextureSampling &sampling)
+{
+	std::string key = TextureKey(path, sampling);
+	if (TextureHandle cached = FindTexture(key))
+	{
+		return cached;
+	}
+
+	TextureCache()[key] = texture;
+	return track(texture);
+}
+
+void TextureManager::shutdown()
+{
+	for (const std::weak_ptr<Texture> &entry : LiveTextures())
+	{
+		if (TextureHandle texture = entry.lock())
+		{
+			glDeleteTextures(1, &texture->id);
+			texture->id = 0;
+		}
+	}
+	LiveTextures().clear();
+	TextureCache().clear();
+	PixelUnpackRing::releaseCurrent();
+}
@@ -0,0 +1,99 @@
+#ifndef _TEXTURE_MANAGER_H_
+#define _TEXTURE_MANAGER_H_
+
+#include <glad/gl.h>
+#include <memory>
+#include <string>
+
+// Sampler state a texture is created with. It is part of the cache key, so the same
+// file loaded with different wrapping or filtering gives two textures.
+struct TextureSampling
+{
+	GLint wrap = GL_REPEAT;
+	GLint minFilter = GL_LINEAR_MIPMAP_LINEAR;
+	GLint magFilter = GL_LINEAR;
+	bool mipmaps = true;
+};
+
+// GL texture owned through a TextureHandle, deleted with the last handle
+struct Texture
+{
+	GLuint id = 0;
+	int width = 0;
+	int height = 0;
+
+	Texture() = default;
+	Texture(const Texture &) = delete;
+	Texture &operator=(const Texture &) = delete;
+	~Texture();
+};
+
+typedef std::shared_ptr<Texture> TextureHandle;
+
+struct CookedImage;
+
+struct ImageDeleter
+{
+	void operator()(unsigned char *pixels) const;
+};
+
+// Tightly packed RGBA8 pixels decoded by stb_image, or a mapped cooked texture that
+// already holds every mip level
+struct Image
+{
+	int width = 0;
+	int height = 0;
+	std::unique_ptr<unsigned char[], ImageDeleter> pixels;
+	std::shared_ptr<const CookedImage> cooked;
+
+	bool valid() const { return pixels != nullptr || cooked != nullptr; }
+	size_t size() const { return static_cast<size_t>(width) * height * 4; }
+};
+
+// Decoding does not touch GL and is safe to run on worker threads
+Image DecodeImageRGBA(const char *file_path);
+Image DecodeImageRGBA(const unsigned char *bytes, size_t size);
+
+// Maps the cooked texture of file_path from the derived data cache, cooking it on a miss,
+// block compressed only when the context has S3TC. Decodes the file itself when the
+// result cannot be stored. Cooking is slow, call it from worker threads.
+Image ReadTextureImage(const std::string &file_path);
+
+// Creates and fills a texture on whichever context is current, without caching or tracking it.
+// Used directly on the upload context; the result goes to TextureManager::adopt or track
+// on the render thread. Null pixels give a 1x1 white texture.
+TextureHandle UploadTexture(int width, int height, const unsigned char *rgba, const TextureSampling &sampling);
+
+// As above for a decoded or cooked image. Cooked mip levels are uploaded as they are,
+// and an invalid image gives the white texture.
+TextureHandle UploadTexture(const Image &image, const TextureSampling &sampling);
+
+// Decodes each image file once and hands out shared GL textures for it
+namespace TextureManager
+{
+	// Returns the cached texture for path and sampling, loading it (cooked if possible) on first use.
+	// An uncooked file is decoded directly and cooked in the background for the next run.
+	// A failed load still returns a 1x1 white texture so callers can always bind it.
+	TextureHandle load(const std::string &path, const TextureSampling &sampling = TextureSampling());
+
+	// Caches an image decoded elsewhere under path, as load() would have. An already
+	// loaded texture for path and sampling wins and image is ignored.
+	TextureHandle adopt(const std::string &path, const Image &image, const TextureSampling &sampling = TextureSampling());
+
+	// Caches a texture uploaded elsewhere under path. An already loaded texture for path
+	// and sampling wins and the given one is dropped.
+	TextureHandle adopt(const std::string &path, const TextureHandle &texture, const TextureSampling &sampling = TextureSampling());
+
+	// Takes over an uncached texture uploaded elsewhere, so shutdown() reaches it
+	TextureHandle track(const TextureHandle &texture);
+
+	// Creates an uncached texture from an image read elsewhere. Null pixels give the white fallback.
+	TextureHandle create(const Image &image, const TextureSampling &sampling = TextureSampling());
+	TextureHandle create(int width, int height, const unsigned char *rgba, const TextureSampling &sampling = TextureSampling());
+
+	// Deletes every texture still alive. Call before the GL context goes away; handles
+	// released afterwards no longer touch GL.
+	void shutdown();
+}
+
+#endif
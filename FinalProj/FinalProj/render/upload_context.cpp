@@ -0,0 +1,115 @@
+#include "upload_context.h"
+#include "pixel_unpack_ring.h"
+
+#include <iostream>
+
+bool PendingUpload::ready()
+{
+	if (signalled)
+	{
+		return true;
+	}
+	if (!submitted.load(std::memory_order_acquire))
+	{
+		return false;
+	}
+
+	// Zero timeout, only asks whether the fence has been reached
+	GLenum status = glClientWaitSync(fence, 0, 0);
+	if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+	{
+		glDeleteSync(fence);
+		fence = nullptr;
+		signalled = true;
+	}
+	return signalled;
+}
+
+bool UploadContext::initialize(GLFWwindow *mainWindow)
+{
+	// The remaining hints (version, profile) still hold from the main window
+	glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+	window = glfwCreateWindow(1, 1, "Loader", NULL, mainWindow);
+	glfwWindowHint(GLFW_VISIBLE, GL_TRUE);
+
+	if (window == NULL)
+	{
+		std::cerr << "Failed to create the upload context, uploading on the render thread." << std::endl;
+		return false;
+	}
+
+	stopping = false;
+	thread = std::thread(&UploadContext::run, this);
+	return true;
+}
+
+void UploadContext::Complete(Job &job)
+{
+	job.run();
+
+	// The flush makes the fence visible to the render context
+	job.upload->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+	job.upload->submitted.store(true, std::memory_order_release);
+}
+
+UploadHandle UploadContext::submit(std::function<void()> job)
+{
+	Job queued = { std::move(job), std::make_shared<PendingUpload>() };
+	UploadHandle upload = queued.upload;
+
+	if (window == NULL)
+	{
+		Complete(queued);
+		return upload;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push(std::move(queued));
+	}
+	wake.notify_one();
+	return upload;
+}
+
+void UploadContext::run()
+{
+	glfwMakeContextCurrent(window);
+
+	for (;;)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if (jobs.empty())
+			{
+				break;
+			}
+			job = std::move(jobs.front());
+			jobs.pop();
+		}
+		Complete(job);
+	}
+
+	PixelUnpackRing::releaseCurrent();
+	glfwMakeContextCurrent(NULL);
+}
+
+void UploadContext::cleanup()
+{
+	if (window == NULL)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	thread.join();
+
+	glfwDestroyWindow(window);
+	window = nullptr;
+}
@@ -0,0 +1,72 @@
+#ifndef _UPLOAD_CONTEXT_H_
+#define _UPLOAD_CONTEXT_H_
+
+#include <glad/gl.h>
+#include <GLFW/glfw3.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+// One job submitted to the UploadContext
+class PendingUpload
+{
+public:
+	// Render thread only. True once the job has run and the GPU has finished its commands,
+	// from then on the objects it filled can be used on the main context.
+	bool ready();
+
+private:
+	friend class UploadContext;
+
+	GLsync fence = nullptr;				// Written before submitted is set
+	std::atomic<bool> submitted{ false };
+	bool signalled = false;
+};
+
+typedef std::shared_ptr<PendingUpload> UploadHandle;
+
+// Hidden window sharing the main context's objects, made current on its own thread.
+// Textures and buffers are filled there and published with a fence, so large uploads
+// never stall the render loop. VAOs and FBOs are not shared between contexts and must
+// still be created on the render thread.
+class UploadContext
+{
+public:
+	UploadContext() = default;
+	UploadContext(const UploadContext &) = delete;
+	UploadContext &operator=(const UploadContext &) = delete;
+
+	// Creates the loader window and starts its thread. Must run on the main thread like
+	// every other GLFW window call. Returns false when no shared context could be made,
+	// submit() then runs jobs directly on the calling thread.
+	bool initialize(GLFWwindow *mainWindow);
+
+	// Queues job to run with the loader context current
+	UploadHandle submit(std::function<void()> job);
+
+	// Finishes the queued jobs, then destroys the loader window
+	void cleanup();
+
+private:
+	struct Job
+	{
+		std::function<void()> run;
+		UploadHandle upload;
+	};
+
+	static void Complete(Job &job);
+	void run();
+
+	GLFWwindow *window = nullptr;
+	std::thread thread;
+	std::queue<Job> jobs;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping = false;
+};
+
+#endif
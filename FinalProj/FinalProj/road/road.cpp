@@ -1,39 +1,14 @@
 #include <glad/gl.h>
 #include <glm/gtc/matrix_transform.hpp>
 #include <render/shader.h>
-#include <stb/stb_image.h>
+#include <render/texture_manager.h>
 #include <iostream>
 #include "road.h"
 
-static GLuint LoadTextureRoad(const char *texture_file_path) {
-    int w, h, channels;
-    uint8_t* img = stbi_load(texture_file_path, &w, &h, &channels, 3);
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-
-    // Set wrapping to repeat
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    if (img) {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, img);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    } else {
-        std::cout << "Failed to load texture " << texture_file_path << std::endl;
-    }
-    stbi_image_free(img);
-
-    return texture;
-}
-
 // OpenGL buffers
 GLuint vertexArrayIDrd;
 GLuint vertexBufferIDrd;
 GLuint indexBufferIDrd;
-GLuint colorBufferIDrd;
 GLuint uvBufferIDrd;
 GLuint textureIDrd;
 
@@ -44,9 +19,6 @@ GLuint programIDrd;
 
 
 void Road::initialize(glm::vec3 position, glm::vec3 scale, const char *texture_file_path) {
-	// Set the color values to white
-	for (int i = 0; i < 12; ++i) color_buffer_data[i] = 1.0f;
-
 	// Define position and scale
 	this->position_rd = position;
 	this->scale_rd = scale;
@@ -59,10 +31,6 @@ void Road::initialize(glm::vec3 position, glm::vec3 scale, const char *texture_f
 	glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vertex_buffer_data), vertex_buffer_data, GL_STATIC_DRAW);
 
-	glGenBuffers(1, &colorBufferID);
-	glBindBuffer(GL_ARRAY_BUFFER, colorBufferID);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(color_buffer_data), color_buffer_data, GL_STATIC_DRAW);
-
 	// Scale UV coordinates
 	for (int i = 0; i < 4; ++i) {
 		uv_buffer_data[i * 2 + 1] *= 10; // Tile 10 times vertically
@@ -84,7 +52,8 @@ void Road::initialize(glm::vec3 position, glm::vec3 scale, const char *texture_f
 	}
 
 	// Load texture
-	textureID = LoadTextureRoad(texture_file_path);
+	texture = TextureManager::load(texture_file_path);
+	textureID = texture->id;
 
 	// Get shader uniforms
 	mvpMatrixID = glGetUniformLocation(programID, "MVP");
@@ -99,10 +68,6 @@ void Road::render(glm::mat4 cameraMatrix) {
 	glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
 
-	glEnableVertexAttribArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, colorBufferID);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
 
 	// Model transform
@@ -131,16 +96,14 @@ void Road::render(glm::mat4 cameraMatrix) {
 	);
 
 	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
     glDisableVertexAttribArray(2);
 }
 
 void Road::cleanup() {
 	glDeleteBuffers(1, &vertexBufferID);
-	glDeleteBuffers(1, &colorBufferID);
 	glDeleteBuffers(1, &indexBufferID);
 	glDeleteVertexArrays(1, &vertexArrayID);
 	glDeleteBuffers(1, &uvBufferID);
-	glDeleteTextures(1, &textureID);
-	glDeleteProgram(programID);
+	texture.reset();
+	ReleaseShaders(programID);
 }
\ No newline at end of file
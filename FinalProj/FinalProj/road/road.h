@@ -2,10 +2,12 @@
 #define ROAD_H
 #include <glm/detail/type_mat.hpp>
 #include "glad/gl.h"
+#include <render/texture_manager.h>
 
 struct Road {
-    GLuint vertexArrayID, vertexBufferID, indexBufferID, colorBufferID, uvBufferID, textureID;
+    GLuint vertexArrayID, vertexBufferID, indexBufferID, uvBufferID, textureID;
     GLuint mvpMatrixID, textureSamplerID, programID;
+    TextureHandle texture;
 
     glm::vec3 position_rd;
     glm::vec3 scale_rd;
@@ -17,13 +19,6 @@ struct Road {
 		-50.0f,  0.0f,  50.0f
 	};
 
-	GLfloat color_buffer_data[12] = {
-		0.0f, 0.0f, 1.0f,
-		0.0f, 0.0f, 1.0f,
-		0.0f, 0.0f, 1.0f,
-		0.0f, 0.0f, 1.0f
-	};
-
 	GLuint index_buffer_data[6] = {	// 12 triangle faces of a box
 		0, 1, 2,
 		0, 2, 3
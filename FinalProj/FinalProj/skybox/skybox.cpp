@@ -2,40 +2,18 @@
 #include "skybox.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include <render/shader.h>
-#include <stb/stb_image.h>
+#include <render/texture_manager.h>
 #include <iostream>
 #define _USE_MATH_DEFINES
 
 
-static GLuint LoadTextureSkybox(const char *texture_file_path) {
-    GLuint textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-
-    int width, height, nrChannels;
-    unsigned char *data = stbi_load(texture_file_path, &width, &height, &nrChannels, 0);
-    if (data) {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-    } else {
-        std::cerr << "Failed to load texture." << std::endl;
-    }
-    stbi_image_free(data);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-    return textureID;
-}
-
 // OpenGL buffers
 GLuint vertexArrayIDsb;
 GLuint vertexBufferIDsb;
 GLuint indexBufferIDsb;
-GLuint colorBufferIDsb;
 GLuint uvBufferIDsb;
 GLuint textureIDsb;
+TextureHandle textureSkybox;
 
 // Shader variable IDs
 GLuint mvpMatrixIDsb;
@@ -43,9 +21,6 @@ GLuint textureSamplerIDsb;
 GLuint programIDsb;
 
 void Skybox::initialize() {
-    // Set the color values to 1
-    for (int i = 0; i < 72; ++i) color_buffer_data[i] = 1.0f;
-
     // Create a vertex array object
     glGenVertexArrays(1, &vertexArrayIDsb);
     glBindVertexArray(vertexArrayIDsb);
@@ -55,11 +30,6 @@ void Skybox::initialize() {
     glBindBuffer(GL_ARRAY_BUFFER, vertexBufferIDsb);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertex_buffer_data), vertex_buffer_data, GL_STATIC_DRAW);
 
-    // Create a vertex buffer object to store the color data
-    glGenBuffers(1, &colorBufferIDsb);
-    glBindBuffer(GL_ARRAY_BUFFER, colorBufferIDsb);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(color_buffer_data), color_buffer_data, GL_STATIC_DRAW);
-
     // Create a vertex buffer object to store the UV data
     glGenBuffers(1, &uvBufferIDsb);
     glBindBuffer(GL_ARRAY_BUFFER, uvBufferIDsb);
@@ -81,7 +51,13 @@ void Skybox::initialize() {
     mvpMatrixIDsb = glGetUniformLocation(programIDsb, "MVP");
 
     // Load texture
-    textureIDsb = LoadTextureSkybox("../FinalProj/skybox/Sky.png");
+    TextureSampling sampling;
+    sampling.wrap = GL_CLAMP_TO_BORDER;
+    sampling.minFilter = GL_NEAREST;
+    sampling.magFilter = GL_NEAREST;
+    sampling.mipmaps = false;
+    textureSkybox = TextureManager::load("../FinalProj/skybox/Sky.png", sampling);
+    textureIDsb = textureSkybox->id;
 
     // Get a handle to texture sampler
     textureSamplerIDsb = glGetUniformLocation(programIDsb,"textureSampler");
@@ -94,10 +70,6 @@ void Skybox::render(glm::mat4 cameraMatrix) {
     glBindBuffer(GL_ARRAY_BUFFER, vertexBufferIDsb);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
 
-    glEnableVertexAttribArray(1);
-    glBindBuffer(GL_ARRAY_BUFFER, colorBufferIDsb);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferIDsb);
 
     // Set model-view-projection matrix
@@ -120,16 +92,14 @@ void Skybox::render(glm::mat4 cameraMatrix) {
     );
 
     glDisableVertexAttribArray(0);
-    glDisableVertexAttribArray(1);
     glDisableVertexAttribArray(2);
 }
 
 void Skybox::cleanup() {
     glDeleteBuffers(1, &vertexBufferIDsb);
-    glDeleteBuffers(1, &colorBufferIDsb);
     glDeleteBuffers(1, &indexBufferIDsb);
     glDeleteVertexArrays(1, &vertexArrayIDsb);
     glDeleteBuffers(1, &uvBufferIDsb);
-    glDeleteTextures(1, &textureIDsb);
-    glDeleteProgram(programIDsb);
+    textureSkybox.reset();
+    ReleaseShaders(programIDsb);
 }
\ No newline at end of file
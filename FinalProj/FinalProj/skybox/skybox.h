@@ -4,7 +4,7 @@
 #include "glad/gl.h"
 
 struct Skybox {
-    GLuint vertexArraySkyboxID, vertexBufferSkyboxID, indexBufferSkyboxID, colorBufferSkyboxID, uvBufferSkyboxID, textureSkyboxID;
+    GLuint vertexArraySkyboxID, vertexBufferSkyboxID, indexBufferSkyboxID, uvBufferSkyboxID, textureSkyboxID;
     GLuint mvpMatrixSkyboxID, textureSamplerSkyboxID, programSkyboxID;
 
 
@@ -46,44 +46,6 @@ struct Skybox {
         -1.0f, -1.0f, 1.0f,
     };
 
-    GLfloat color_buffer_data[72] = {
-        // Front, red
-        1.0f, 0.0f, 0.0f,
-        1.0f, 0.0f, 0.0f,
-        1.0f, 0.0f, 0.0f,
-        1.0f, 0.0f, 0.0f,
-
-        // Back, yellow
-        1.0f, 1.0f, 0.0f,
-        1.0f, 1.0f, 0.0f,
-        1.0f, 1.0f, 0.0f,
-        1.0f, 1.0f, 0.0f,
-
-        // Left, green
-        0.0f, 1.0f, 0.0f,
-        0.0f, 1.0f, 0.0f,
-        0.0f, 1.0f, 0.0f,
-        0.0f, 1.0f, 0.0f,
-
-        // Right, cyan
-        0.0f, 1.0f, 1.0f,
-        0.0f, 1.0f, 1.0f,
-        0.0f, 1.0f, 1.0f,
-        0.0f, 1.0f, 1.0f,
-
-        // Top, blue
-        0.0f, 0.0f, 1.0f,
-        0.0f, 0.0f, 1.0f,
-        0.0f, 0.0f, 1.0f,
-        0.0f, 0.0f, 1.0f,
-
-        // Bottom, magenta
-        1.0f, 0.0f, 1.0f,
-        1.0f, 0.0f, 1.0f,
-        1.0f, 0.0f, 1.0f,
-        1.0f, 0.0f, 1.0f,
-    };
-
     GLuint index_buffer_data[36] = {
         0, 3, 2,
         0, 2, 1,
@@ -3,6 +3,8 @@
 #include <render/shader.h>
 #include <glm/gtc/matrix_transform.hpp>
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cmath>
 
 void Blades::generateGeometry() {
     vertex_buffer_data = {
@@ -63,10 +65,18 @@ void Blades::initialize(glm::vec3 position, glm::vec3 scale) {
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_buffer_data.size() * sizeof(GLuint), index_buffer_data.data(), GL_STATIC_DRAW);
 
     programID = LoadShadersFromFile("../FinalProj/windmill/windmill.vert", "../FinalProj/windmill/windmill.frag");
-    mvpMatrixID = glGetUniformLocation(programID, "MVP");
+    modelMatrixID = ShaderProgram(programID).uniform("model");
 }
 
-void Blades::render(glm::mat4 cameraMatrix) {
+// Blades reach 3 from the hub in the xy plane and spin about z, so any rotation stays within
+// the square around the circle they sweep
+void Blades::bounds(glm::vec3& boundsMin, glm::vec3& boundsMax) const {
+    float reach = 3.0f * std::max(std::abs(scale.x), std::abs(scale.y));
+    boundsMin = position - glm::vec3(reach, reach, 0.0f);
+    boundsMax = position + glm::vec3(reach, reach, 0.0f);
+}
+
+void Blades::render() {
     static float rotationAngle = 0.0f;
     rotationAngle += 0.2f;
 
@@ -86,9 +96,8 @@ void Blades::render(glm::mat4 cameraMatrix) {
     modelMatrix = glm::rotate(modelMatrix, glm::radians(rotationAngle), glm::vec3(0.0f, 0.0f, 1.0f)); // Z-axis rotation
     modelMatrix = glm::scale(modelMatrix, scale);
 
-    // Calculate final MVP matrix
-    glm::mat4 mvp = cameraMatrix * modelMatrix;
-    glUniformMatrix4fv(mvpMatrixID, 1, GL_FALSE, &mvp[0][0]);
+    // View-projection is applied from the frame uniform buffer
+    glUniformMatrix4fv(modelMatrixID, 1, GL_FALSE, &modelMatrix[0][0]);
 
     // Draw the blades
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
@@ -104,5 +113,5 @@ void Blades::cleanup() {
     glDeleteBuffers(1, &colorBufferID);
     glDeleteBuffers(1, &indexBufferID);
     glDeleteVertexArrays(1, &vertexArrayID);
-    glDeleteProgram(programID);
+    ReleaseShaders(programID);
 }
\ No newline at end of file
@@ -5,7 +5,7 @@
 #include <glad/gl.h>
 
 struct Blades {
-    GLuint vertexArrayID, vertexBufferID, indexBufferID, colorBufferID, programID, mvpMatrixID;
+    GLuint vertexArrayID, vertexBufferID, indexBufferID, colorBufferID, programID, modelMatrixID;
 
     glm::vec3 position;
     glm::vec3 scale;
@@ -16,7 +16,9 @@ struct Blades {
 
     void generateGeometry();
     void initialize(glm::vec3 position, glm::vec3 scale);
-    void render(glm::mat4 cameraMatrix);
+    void render();
+    // World-space box around everything render() draws
+    void bounds(glm::vec3& boundsMin, glm::vec3& boundsMax) const;
     void cleanup();
 };
 
@@ -79,10 +79,18 @@ void Windmill::initialize(glm::vec3 position, glm::vec3 scale) {
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_buffer_data.size() * sizeof(GLuint), index_buffer_data.data(), GL_STATIC_DRAW);
 
     programID = LoadShadersFromFile("../FinalProj/windmill/windmill.vert", "../FinalProj/windmill/windmill.frag");
-    mvpMatrixID = glGetUniformLocation(programID, "MVP");
+    ShaderProgram program(programID);
+    modelMatrixID = program.uniform("model");
+    hasTextureID = program.uniform("hasTexture");
 }
 
-void Windmill::render(glm::mat4 cameraMatrix) {
+// Cylinder of radius 1 and height 2 from generateGeometry, scaled and moved as render() does
+void Windmill::bounds(glm::vec3& boundsMin, glm::vec3& boundsMax) const {
+    boundsMin = position + scale * glm::vec3(-1.0f, 0.0f, -1.0f);
+    boundsMax = position + scale * glm::vec3(1.0f, 2.0f, 1.0f);
+}
+
+void Windmill::render() {
     // Reset texture state
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, 0);
@@ -90,7 +98,7 @@ void Windmill::render(glm::mat4 cameraMatrix) {
     glUseProgram(programID);
 
     glBindVertexArray(vertexArrayID);
-    glUniform1i(glGetUniformLocation(programID, "hasTexture"), 0);
+    glUniform1i(hasTextureID, 0);
 
 
     glEnableVertexAttribArray(0);
@@ -104,8 +112,7 @@ void Windmill::render(glm::mat4 cameraMatrix) {
     glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), position);
     modelMatrix = glm::scale(modelMatrix, scale);
 
-    glm::mat4 mvp = cameraMatrix * modelMatrix;
-    glUniformMatrix4fv(mvpMatrixID, 1, GL_FALSE, &mvp[0][0]);
+    glUniformMatrix4fv(modelMatrixID, 1, GL_FALSE, &modelMatrix[0][0]);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
     glDrawElements(GL_TRIANGLES, index_buffer_data.size(), GL_UNSIGNED_INT, (void*)0);
@@ -119,5 +126,5 @@ void Windmill::cleanup() {
     glDeleteBuffers(1, &colorBufferID);
     glDeleteBuffers(1, &indexBufferID);
     glDeleteVertexArrays(1, &vertexArrayID);
-    glDeleteProgram(programID);
+    ReleaseShaders(programID);
 }
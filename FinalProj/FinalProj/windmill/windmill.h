@@ -5,7 +5,8 @@
 #include <glad/gl.h>
 
 struct Windmill {
-    GLuint vertexArrayID, vertexBufferID, indexBufferID, colorBufferID, programID, mvpMatrixID;
+    GLuint vertexArrayID, vertexBufferID, indexBufferID, colorBufferID, programID, modelMatrixID;
+    GLint hasTextureID;
 
     glm::vec3 position;
     glm::vec3 scale;
@@ -16,7 +17,9 @@ struct Windmill {
 
     void generateGeometry(int slices, float height, float radius);
     void initialize(glm::vec3 position, glm::vec3 scale);
-    void render(glm::mat4 cameraMatrix);
+    void render();
+    // World-space box around everything render() draws
+    void bounds(glm::vec3& boundsMin, glm::vec3& boundsMax) const;
     void cleanup();
 };
 
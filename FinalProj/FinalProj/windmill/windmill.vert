@@ -4,7 +4,15 @@ layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inUV;
 
-uniform mat4 MVP;
+layout(std140) uniform FrameConstants {
+    mat4 viewProjection;
+    mat4 lightSpaceMatrix;
+    vec4 lightPosition;
+    vec4 lightIntensity;
+    vec4 viewPosition;
+};
+
+uniform mat4 model;
 
 out vec3 color;
 out vec2 uv;
@@ -15,6 +23,6 @@ void main() {
     // Pass vertex color to the fragment shader
     color = inColor;
 
-    // Calculate position using MVP matrix
-    gl_Position = MVP * vec4(inPosition, 1.0);
+    // Calculate position using the frame view-projection matrix
+    gl_Position = viewProjection * model * vec4(inPosition, 1.0);
 }
\ No newline at end of file